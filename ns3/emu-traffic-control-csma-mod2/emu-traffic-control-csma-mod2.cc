@@ -0,0 +1,495 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+//
+// This is an illustration of how one could use virtualization techniques to
+// allow running applications on virtual machines talking over simulated
+// networks.
+//
+// The actual steps required to configure the virtual machines can be rather
+// involved, so we don't go into that here.  Please have a look at one of
+// our HOWTOs on the nsnam wiki for more details about how to get the 
+// system confgured.  For an example, have a look at "HOWTO Use Linux 
+// Containers to set up virtual networks" which uses this code as an 
+// example.
+//
+// The configuration you are after is explained in great detail in the 
+// HOWTO, but looks like the following:
+//
+//
+// Allow ns-3 to ping a real host somewhere, using emulation mode
+//
+//   +----------------------+    
+//   |          host        |
+//   +----------------------+    
+//   |    ns-3 simulation   |                                      
+//   +----------------------+                  
+//   |      ns-3 Node       |                 
+//   |  +----------------+  |                 
+//   |  |    ns-3 TCP    |  |              
+//   |  +----------------+  |              
+//   |  |    ns-3 IPv4   |  |                 
+//   |  +----------------+  |                 
+//   |  | RawEmuNetDevice|  |                
+//   |--+----------------+--+     
+//   |       | eth0 |       |                
+//   |       +------+       |    
+//   |          |           |
+//   +----------|-----------+ 
+//              |
+//              |         +---------+
+//              .---------| GW host |--- (Internet) -----                             
+//                        +---------+ 
+//
+//  1) You need to decide on a physical device on your real system, and either
+//     overwrite the hard-configured device name below (eth0) or pass this
+//     device name in as a command-line argument
+//  2) The host device must be set to promiscuous mode
+//     (e.g. "sudo ifconfig eth0 promisc")
+//  3) Be aware that ns-3 will generate a fake mac address, and that in
+//     some enterprise networks, this may be considered bad form to be
+//     sending packets out of your device with "unauthorized" mac addresses
+//  4) You will need to assign an IP address to the ns-3 simulation node that
+//     is consistent with the subnet that is active on the host device's link.
+//     That is, you will have to assign an IP address to the ns-3 node as if
+//     it were on your real subnet.  Search for "Ipv4Address localIp" and
+//     replace the string "1.2.3.4" with a valid IP address.
+//  5) You will need to configure a default route in the ns-3 node to tell it
+//     how to get off of your subnet. One thing you could do is a
+//     'netstat -rn' command and find the IP address of the default gateway
+//     on your host.  Search for "Ipv4Address gateway" and replace the string
+//     "1.2.3.4" string with the gateway IP address.
+//  6) The emu devices open their raw sockets themselves (they need kernel
+//     receive timestamps, which the ns3-dev-raw-sock-creator path does not
+//     give us), so run the program as root or give it CAP_NET_RAW:
+//
+//     $ sudo ./waf --run emu-traffic-control-csma-mod2
+//
+//     The emu devices read one wire frame at a time, so turn off receive
+//     offloads that merge frames in the host kernel (and segmentation
+//     offloads, so the peer sees wire-sized frames too) on every emu
+//     interface:
+//
+//     $ sudo ethtool -K enp0s8 gro off lro off tso off gso off
+//
+//     Frames that still arrive too large are dropped, counted and printed
+//     at the end of the run.
+//
+//  7) Instead of one host NIC per ghost node, all ghost nodes can share one
+//     802.1Q trunk: ghost node i is the port for VLAN vid = firstVlanId + i
+//     and gets 10.161.vid.20/24, so every VLAN id must fit in one octet.
+//     The VLAN interfaces (eno1.29, eno1.30, ...) go on the peer machine, not
+//     on this VM: frames written to a raw socket never reach VLAN interfaces
+//     of the same host (see setup-nic-aliases-ubuntu.md).  On this VM, run
+//     the program on the NIC that reaches the peer, e.g.
+//
+//     $ sudo ./waf --run "emu-traffic-control-csma-mod2 --trunkDevice=enp0s8 --segments=64"
+//
+
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <fstream>
+#include <vector>
+
+#include "ns3/abort.h"
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/internet-apps-module.h"
+#include "ns3/ipv4-static-routing-helper.h"
+#include "ns3/ipv4-list-routing-helper.h"
+#include "ns3/ipv4-global-routing-helper.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/csma-module.h"
+
+// Switched full-duplex segment used between the ghost nodes.  This program
+// lives in its own scratch/ subdirectory so waf builds it together with
+// switched-ethernet.cc.
+#include "switched-ethernet.h"
+#include "segment-offload.h"
+#include "raw-emu-net-device.h"
+//#include "ipv4-l3-protocol.h"
+
+// #include "ns3/netanim-module.h"
+#include "ns3/applications-module.h"
+
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("TrafficReceiver");
+
+static void
+PingRtt (std::string context, Time rtt)
+{
+  NS_LOG_UNCOND ("Received Response with RTT = " << rtt);
+}
+
+
+int 
+main (int argc, char *argv[])
+{
+    NS_LOG_INFO ("Jetson K3S Emulation");
+
+    // Network IP is not fully describe but one forum found a solution
+    // https://www.linuxquestions.org/questions/linux-newbie-8/address-overflow-913427/
+
+    std::string deviceName1 ("enp0s8");
+    std::string deviceIp1   ("10.161.29.20");
+    std::string deviceMask1 ("255.255.255.0");
+
+    std::string deviceName2 ("enp0s9");
+    std::string deviceIp2   ("10.161.30.20");
+    std::string deviceMask2 ("255.255.255.0");
+
+    std::string deviceName3 ("enp0s10");
+    std::string deviceIp3   ("10.161.31.20");
+    std::string deviceMask3 ("255.255.255.0");
+
+/*
+    // 'netstat -rn' command and find the IP address of the default gateway on your host
+    std::string deviceGateway1("0.0.0.0");
+    std::string deviceGateway2("0.0.0.0");
+*/
+    std::string dataRate("5Mbps");
+    std::string dataDelay("20ms");
+    double stopTime = 30;
+    bool gro = false;
+
+    // VLAN trunk mode, used when trunkDevice is set
+    std::string trunkDevice ("");
+    uint32_t segments = 3;
+    uint32_t firstVlanId = 29;
+
+    //COMMAND LINE VARIABLES AND SETUP
+    CommandLine cmd;
+
+    // Add custom made command line flags
+    cmd.AddValue("dataRate",  "Data Rate (per port and direction)", dataRate);
+    cmd.AddValue("dataDelay", "Packet delay", dataDelay);
+    cmd.AddValue("stopTime",  "Stop time (seconds)", stopTime);
+    cmd.AddValue("gro",       "Coalesce bulk TCP segments on the emu devices", gro);
+    cmd.AddValue("trunkDevice", "Host 802.1Q trunk interface (empty: one NIC per ghost node)", trunkDevice);
+    cmd.AddValue("segments",    "Number of ghost nodes on the trunk (at most 64)", segments);
+    cmd.AddValue("firstVlanId", "VLAN id of the first ghost node on the trunk", firstVlanId);
+
+    cmd.Parse (argc, argv);
+
+    bool trunk = !trunkDevice.empty ();
+
+    // the VLAN id is the third octet of the segment's subnet
+    NS_ABORT_MSG_IF (trunk && (segments == 0 || segments > 64), "segments must be between 1 and 64");
+    NS_ABORT_MSG_IF (trunk && (firstVlanId == 0 || firstVlanId + segments - 1 > 255),
+                     "VLAN ids must be between 1 and 255");
+
+    uint32_t nodeCount = trunk ? segments : 3;
+
+
+    NS_LOG_INFO ("Start app...");
+
+    std::cout << 
+          "dataRate: "  << dataRate.c_str ()  <<
+        ", dataDelay: " << dataDelay.c_str () <<
+        ", stopTime: "  << stopTime           <<
+        ", gro: "       << gro                << std::endl;
+
+    if (trunk)
+      {
+        std::cout <<
+              "trunkDevice: "   << trunkDevice.c_str () <<
+            ", segments: "      << segments             <<
+            ", firstVlanId: "   << firstVlanId          << std::endl;
+      }
+    
+//  LogComponentEnable ("TestApp", LOG_LEVEL_INFO);
+
+    std::vector<Ipv4Address> localIps;
+    std::vector<Ipv4Mask> localMasks;
+    if (trunk)
+      {
+        // One /24 per segment, named after its VLAN: 10.161.<vid>.20
+        for (uint32_t i = 0; i < segments; ++i)
+          {
+            std::ostringstream ip;
+            ip << "10.161." << firstVlanId + i << ".20";
+            localIps.push_back (Ipv4Address (ip.str ().c_str ()));
+            localMasks.push_back (Ipv4Mask ("255.255.255.0"));
+          }
+      }
+    else
+      {
+        // Left Side
+        localIps.push_back (Ipv4Address (deviceIp1.c_str ()));
+        localMasks.push_back (Ipv4Mask (deviceMask1.c_str ()));
+        // Ipv4Address gateway1(deviceGateway1.c_str ());
+
+        // Middle
+        localIps.push_back (Ipv4Address (deviceIp2.c_str ()));
+        localMasks.push_back (Ipv4Mask (deviceMask2.c_str ()));
+        // Ipv4Address gateway2(deviceGateway2.c_str ());
+
+        // Right side
+        localIps.push_back (Ipv4Address (deviceIp3.c_str ()));
+        localMasks.push_back (Ipv4Mask (deviceMask3.c_str ()));
+        // Ipv4Address gateway3(deviceGateway3.c_str ());
+      }
+
+    //
+    // We are interacting with the outside, real, world.  This means we have to 
+    // interact in real-time and therefore means we have to use the real-time
+    // simulator and take the time to calculate checksums.
+    //
+    GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::RealtimeSimulatorImpl"));
+    GlobalValue::Bind ("ChecksumEnabled", BooleanValue (true));
+
+    //
+    // Create the ghost nodes, 3 or one per trunk segment
+    //
+    NS_LOG_INFO ("  Create " << nodeCount << " Nodes");
+
+    NodeContainer nodes;
+    nodes.Create (nodeCount);
+
+    //
+    // Set up a switched segment between ghost nodes.  Every ghost node gets
+    // its own full-duplex port, so dataRate is available per port and per
+    // direction instead of being shared by all nodes like on a CSMA channel.
+    //
+    NS_LOG_INFO ("  Setup switched Ethernet segment");
+
+    SwitchedEthernetHelper csma;
+
+    csma.SetChannelAttribute ("DataRate", StringValue (dataRate));
+    csma.SetChannelAttribute ("Delay",    StringValue (dataDelay));
+
+    if (gro)
+      {
+        //
+        // The emu devices merge bulk TCP segments as they read them and cut
+        // them back into the original frames where they leave again.
+        // Segments are only merged while they arrive at least as fast as
+        // dataRate carries them, i.e. while the port link would still be
+        // busy with the one before, so the segment can time the merged
+        // packet as the frames it stands for.
+        //
+        // The first segment of a merged packet would only be forwarded one
+        // frame time plus dataDelay after it arrived, so holding it that
+        // long for more costs nothing.  Under a standing queue that is
+        // about (dataDelay / frame time) + 1 segments per packet: 10 at
+        // 5Mbps and 20ms.
+        //
+        // Coalesced packets are up to 64 KB long, so neither the emu devices
+        // nor the segment must make IPv4 fragment them.  Queues are sized in
+        // bytes (100 full frames) so a coalesced packet takes the queue space
+        // of the frames it carries, not of one frame.
+        //
+        Time maxHold = Time (dataDelay) + DataRate (dataRate).CalculateBytesTxTime (1514);
+        Config::SetDefault ("ns3::RawEmuNetDevice::CoalesceDataRate", DataRateValue (DataRate (dataRate)));
+        Config::SetDefault ("ns3::RawEmuNetDevice::CoalesceMaxHold", TimeValue (Min (maxHold, Seconds (1))));
+        Config::SetDefault ("ns3::RawEmuNetDevice::Mtu", UintegerValue (65535));
+        csma.SetDeviceAttribute ("Mtu", UintegerValue (65535));
+        csma.SetQueue ("ns3::DropTailQueue", "MaxSize", QueueSizeValue (QueueSize ("151400B")));
+      }
+
+    NetDeviceContainer csmaDevices;
+    csmaDevices = csma.Install (nodes);
+
+
+    //
+    // Add a default internet stack to the node.  This gets us the ns-3 versions
+    // of ARP, IPv4, ICMP, UDP and TCP.
+    //
+    NS_LOG_INFO ("  Add Internet Stack");
+    InternetStackHelper internetStackHelper;
+    internetStackHelper.Install (nodes);
+
+    Ipv4AddressHelper address;
+    address.SetBase("192.134.135.0", "255.255.255.0");
+    Ipv4InterfaceContainer csmaInterfaces;
+    csmaInterfaces = address.Assign(csmaDevices);
+
+    //
+    // Create an emu device, allocate a MAC address and point the device to the
+    // Linux device name.  The device needs a transmit queueing discipline so
+    // create a droptail queue and give it to the device.  Finally, "install"
+    // the device into the node.
+    //
+    // Do understand that the ns-3 allocated MAC address will be sent out over
+    // your network since the emu net device will spoof it.  By default, this
+    // address will have an Organizationally Unique Identifier (OUI) of zero.
+    // The Internet Assigned Number Authority IANA
+    //
+    //  http://www.iana.org/assignments/ethernet-numbers
+    //
+    // reports that this OUI is unassigned, and so should not conflict with
+    // real hardware on your net.  It may raise all kinds of red flags in a
+    // real environment to have packets from a device with an obviously bogus
+    // OUI flying around.  Be aware.
+    //
+    // Every frame read from the host is stamped by the kernel on arrival, and
+    // the segment starts sending it from that time rather than from when it
+    // was picked up, so dataDelay counts from when the frame really arrived.
+    //
+    // In trunk mode all emu devices share one socket on trunkDevice.  Each is
+    // the port for its own VLAN: frames are dispatched to it by VLAN id and
+    // tagged with that id on the way out.
+    //
+    NS_LOG_INFO ("  Create RawEmuNetDevice...");
+
+    NetDeviceContainer emuDevices;
+    if (trunk)
+      {
+        RawEmuNetDeviceHelper emu;
+        emu.SetDeviceName (trunkDevice);
+
+        emuDevices = emu.Install (nodes, firstVlanId);
+      }
+    else
+      {
+        // emu1
+        RawEmuNetDeviceHelper emu1;
+        emu1.SetDeviceName (deviceName1);
+
+        NetDeviceContainer devices1 = emu1.Install (nodes.Get (0));
+        Ptr<NetDevice> device1 = devices1.Get (0);
+
+        // emu2
+        RawEmuNetDeviceHelper emu2;
+        emu2.SetDeviceName (deviceName2);
+
+        NetDeviceContainer devices2 = emu2.Install (nodes.Get (1));
+        Ptr<NetDevice> device2 = devices2.Get (0);
+
+        // emu3
+        RawEmuNetDeviceHelper emu3;
+        emu3.SetDeviceName (deviceName3);
+
+        NetDeviceContainer devices3 = emu3.Install (nodes.Get (2));
+        Ptr<NetDevice> device3 = devices3.Get (0);
+
+//        device1->SetAttribute ("Address", Mac48AddressValue ("08:00:27:83:9c:c8"));
+//        device2->SetAttribute ("Address", Mac48AddressValue ("08:00:27:a8:6e:a9"));
+
+        device1->SetAttribute ("Address", Mac48AddressValue ("08:00:27:b3:a5:82"));   // enp0s8
+        device2->SetAttribute ("Address", Mac48AddressValue ("08:00:27:7f:d9:0c"));   // enp0s9
+        device3->SetAttribute ("Address", Mac48AddressValue ("08:00:27:dc:60:80"));   // enp0s10
+
+        emuDevices.Add (devices1);
+        emuDevices.Add (devices2);
+        emuDevices.Add (devices3);
+      }
+
+
+
+    NS_LOG_INFO ("  Create IPv4 Interfaces");
+
+    for (uint32_t i = 0; i < emuDevices.GetN (); ++i)
+      {
+        Ptr<Ipv4> ipv4 = nodes.Get (i)->GetObject<Ipv4> ();
+        uint32_t interface = ipv4->AddInterface (emuDevices.Get (i));
+        Ipv4InterfaceAddress ifAddress = Ipv4InterfaceAddress (localIps[i], localMasks[i]);
+        ipv4->AddAddress (interface, ifAddress);
+        ipv4->SetMetric (interface, 1);
+        ipv4->SetUp (interface);
+        ipv4->SetAttribute("IpForward", BooleanValue(true));
+      }
+
+    //
+    // Create the ping application.  This application knows how to send
+    // ICMP echo requests.  Setting up the packet sink manually is a bit
+    // of a hassle and since there is no law that says we cannot mix the
+    // helper API with the low level API, let's just use the helper.
+    //
+
+//    NS_LOG_INFO ("Create V4Ping Appliation");
+
+    // std::string remoteIpstr("192.134.135.2");
+//    std::string remoteIpstr("172.161.29.2");
+//    Ipv4Address remoteIp(remoteIpstr.c_str());
+
+
+    //
+    // Print routing table to a file
+    //
+    // Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+    Ipv4GlobalRoutingHelper g;
+    
+    g.PopulateRoutingTables ();
+    Ptr<OutputStreamWrapper> routingStream = Create<OutputStreamWrapper> ("routes_emu.routes", std::ios::out);
+    g.PrintRoutingTableAllAt (Seconds (15), routingStream);
+
+
+    //
+    // Hook a trace to print something when the response comes back.
+    //
+    Config::Connect ("/Names/app/Rtt", MakeCallback (&PingRtt));
+ 
+    //
+    // Enable a promiscuous pcap trace to see what is coming and going on our device.
+    // To Check PCAP use the following:
+    // tcpdump -nn -tt -r <PCAP FILE NAME>.pcap 
+
+    RawEmuNetDeviceHelper emu;
+    for (uint32_t i = 0; i < emuDevices.GetN (); ++i)
+      {
+        std::ostringstream name;
+        if (trunk)
+          {
+            name << "vlan" << DynamicCast<RawEmuNetDevice> (emuDevices.Get (i))->GetVlanId ();
+          }
+        else
+          {
+            const char *sides[] = { "left", "middle", "right" };
+            name << sides[i];
+          }
+        emu.EnablePcap ("fd-" + name.str (), emuDevices.Get (i), true);
+        csma.EnablePcap ("csma-" + name.str (), csmaDevices.Get (i), true);
+      }
+
+
+    //
+    // Run the simulation for ten minutes to give the user time to play around
+    //
+    NS_LOG_INFO ("Run Emulation.");
+    // Simulator::Stop (Seconds (25.0));
+    Simulator::Stop (Seconds ( stopTime ));
+
+    Simulator::Run ();
+
+    NS_LOG_INFO ("Ingest wait (kernel timestamp to socket read)");
+    for (uint32_t i = 0; i < emuDevices.GetN (); ++i)
+      {
+        Ptr<RawEmuNetDevice> emuDevice = DynamicCast<RawEmuNetDevice> (emuDevices.Get (i));
+        std::cout << "emu" << i + 1 << " ";
+        emuDevice->PrintIngestWait (std::cout);
+        if (emuDevice->GetTruncatedFrames () > 0)
+          {
+            std::cout << "emu" << i + 1 << " truncated frames dropped: " << emuDevice->GetTruncatedFrames () <<
+                " (GRO/LRO still on on the host interface?)" << std::endl;
+          }
+        if (gro)
+          {
+            std::cout << "emu" << i + 1 << " segments: " << emuDevice->GetReceivedSegments () <<
+                ", delivered after coalescing: " << emuDevice->GetReceivedPackets () << std::endl;
+          }
+      }
+
+    // std::cout << "Animation Trace file created: " << animFile.c_str ()<<std::endl;
+    Simulator::Destroy ();
+
+    NS_LOG_INFO ("Done");
+}
+
@@ -0,0 +1,85 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ingest-wait-tag.h"
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (IngestWaitTag);
+
+//
+// IngestWaitTag
+//
+
+TypeId
+IngestWaitTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::IngestWaitTag")
+    .SetParent<Tag> ()
+    .SetGroupName ("SwitchedEthernet")
+    .AddConstructor<IngestWaitTag> ()
+  ;
+  return tid;
+}
+
+TypeId
+IngestWaitTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+IngestWaitTag::IngestWaitTag ()
+  : m_wait (0)
+{
+}
+
+uint32_t
+IngestWaitTag::GetSerializedSize (void) const
+{
+  return 8;
+}
+
+void
+IngestWaitTag::Serialize (TagBuffer i) const
+{
+  i.WriteU64 (m_wait);
+}
+
+void
+IngestWaitTag::Deserialize (TagBuffer i)
+{
+  m_wait = i.ReadU64 ();
+}
+
+void
+IngestWaitTag::Print (std::ostream &os) const
+{
+  os << "wait=" << m_wait << "ns";
+}
+
+void
+IngestWaitTag::SetWait (Time wait)
+{
+  m_wait = wait.GetNanoSeconds ();
+}
+
+Time
+IngestWaitTag::GetWait (void) const
+{
+  return NanoSeconds (m_wait);
+}
+
+} // namespace ns3
@@ -0,0 +1,1157 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "raw-emu-net-device.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include "ns3/ethernet-header.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("RawEmuNetDevice");
+
+NS_OBJECT_ENSURE_REGISTERED (RawEmuNetDevice);
+
+static int64_t
+RealtimeNowNs (void)
+{
+  struct timespec now;
+  clock_gettime (CLOCK_REALTIME, &now);
+  return (int64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+//
+// RawEmuTrunk
+//
+
+const uint16_t RawEmuTrunk::VLAN_IDS;
+
+// frames read in one go before the trunk thread looks at its timers again
+static const uint32_t READ_BATCH = 64;
+
+RawEmuTrunk::RawEmuTrunk ()
+  : m_fd (-1),
+    m_bufferSize (65536),
+    m_thread (0),
+    m_ports (VLAN_IDS),
+    m_stop (false)
+{
+  NS_LOG_FUNCTION (this);
+  m_wakeFds[0] = -1;
+  m_wakeFds[1] = -1;
+}
+
+RawEmuTrunk::~RawEmuTrunk ()
+{
+  NS_LOG_FUNCTION (this);
+  Stop ();
+}
+
+void
+RawEmuTrunk::SetFileDescriptor (int fd)
+{
+  NS_LOG_FUNCTION (this << fd);
+  m_fd = fd;
+}
+
+void
+RawEmuTrunk::SetBufferSize (uint32_t bufferSize)
+{
+  NS_LOG_FUNCTION (this << bufferSize);
+  m_bufferSize = bufferSize;
+}
+
+void
+RawEmuTrunk::AddPort (uint16_t vlanId, Ptr<RawEmuNetDevice> device)
+{
+  NS_LOG_FUNCTION (this << vlanId << device);
+  NS_ABORT_MSG_IF (vlanId >= VLAN_IDS, "RawEmuTrunk::AddPort(): VLAN id " << vlanId << " out of range");
+  NS_ABORT_MSG_IF (m_ports[vlanId].device != 0, "RawEmuTrunk::AddPort(): VLAN " << vlanId << " already has a port");
+  NS_ABORT_MSG_IF (m_thread != 0, "RawEmuTrunk::AddPort(): trunk already started");
+
+  m_ports[vlanId].device = PeekPointer (device);
+  m_ports[vlanId].context = device->GetNode ()->GetId ();
+}
+
+void
+RawEmuTrunk::Start (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  if (m_thread != 0)
+    {
+      return;
+    }
+  NS_ABORT_MSG_IF (m_fd == -1, "RawEmuTrunk::Start(): no file descriptor set");
+
+  // the thread reads the limits without locking, so take them now
+  for (std::vector<Port>::iterator i = m_ports.begin (); i != m_ports.end (); ++i)
+    {
+      if (i->device != 0)
+        {
+          i->limits = i->device->GetCoalescingLimits ();
+        }
+    }
+
+  NS_ABORT_MSG_IF (pipe (m_wakeFds) == -1, "RawEmuTrunk::Start(): pipe() failed: " << std::strerror (errno));
+  fcntl (m_wakeFds[0], F_SETFL, O_NONBLOCK);
+  fcntl (m_wakeFds[1], F_SETFL, O_NONBLOCK);
+
+  m_stop = false;
+  m_thread = Create<SystemThread> (MakeCallback (&RawEmuTrunk::Run, this));
+  m_thread->Start ();
+}
+
+void
+RawEmuTrunk::Stop (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  if (m_thread != 0)
+    {
+      {
+        CriticalSection cs (m_mutex);
+        m_stop = true;
+      }
+      Wake ();
+      m_thread->Join ();
+      m_thread = 0;
+
+      std::vector<RawFrame> held;
+      m_coalescer.Flush (held);
+      for (std::vector<RawFrame>::iterator i = held.begin (); i != held.end (); ++i)
+        {
+          free (i->buffer);
+        }
+
+      close (m_wakeFds[0]);
+      close (m_wakeFds[1]);
+      m_wakeFds[0] = -1;
+      m_wakeFds[1] = -1;
+    }
+
+  for (std::multimap<int64_t, PendingFrame>::iterator i = m_pending.begin (); i != m_pending.end (); ++i)
+    {
+      free (i->second.buffer);
+    }
+  m_pending.clear ();
+
+  if (m_fd != -1)
+    {
+      close (m_fd);
+      m_fd = -1;
+    }
+  m_ports.assign (VLAN_IDS, Port ());
+}
+
+void
+RawEmuTrunk::Wake (void)
+{
+  char c = 0;
+  // a full pipe already wakes the thread
+  if (write (m_wakeFds[1], &c, 1) == -1 && errno != EAGAIN)
+    {
+      NS_LOG_ERROR ("RawEmuTrunk::Wake(): write() failed: " << std::strerror (errno));
+    }
+}
+
+void
+RawEmuTrunk::Run (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  //
+  // We are in the trunk thread.  Read what the socket has, find the port of
+  // every frame by direct lookup, let the coalescer hold on to segments
+  // that may get company, and schedule an event for everything it is done
+  // with.  Frames for VLANs without a port never become events.  In
+  // between, write the frames that have become due, and sleep until the
+  // socket or the pipe is readable or the next timer runs out.
+  //
+  std::vector<RawFrame> ready;
+  int64_t nextExpiry = -1;
+  while (true)
+    {
+      int64_t now = RealtimeNowNs ();
+      int64_t next = SendDue (now);
+      if (nextExpiry != -1 && (next == -1 || nextExpiry < next))
+        {
+          next = nextExpiry;
+        }
+
+      struct timespec timeout;
+      struct timespec *timeoutPointer = 0;
+      if (next != -1)
+        {
+          int64_t wait = std::max<int64_t> (next - now, 0);
+          timeout.tv_sec = wait / 1000000000;
+          timeout.tv_nsec = wait % 1000000000;
+          timeoutPointer = &timeout;
+        }
+
+      struct pollfd fds[2];
+      fds[0].fd = m_fd;
+      fds[0].events = POLLIN;
+      fds[0].revents = 0;
+      fds[1].fd = m_wakeFds[0];
+      fds[1].events = POLLIN;
+      fds[1].revents = 0;
+
+      if (ppoll (fds, 2, timeoutPointer, 0) == -1 && errno != EINTR)
+        {
+          NS_FATAL_ERROR ("RawEmuTrunk::Run(): ppoll() failed: " << std::strerror (errno));
+        }
+
+      if (fds[1].revents & POLLIN)
+        {
+          char buf[64];
+          while (read (m_wakeFds[0], buf, sizeof (buf)) > 0)
+            {
+            }
+        }
+
+      {
+        CriticalSection cs (m_mutex);
+        if (m_stop)
+          {
+            break;
+          }
+      }
+
+      RawFrame frame;
+      for (uint32_t i = 0; i < READ_BATCH && Read (frame); ++i)
+        {
+          const Port &port = m_ports[frame.vlanId];
+          if (port.device == 0)
+            {
+              free (frame.buffer);
+              continue;
+            }
+          m_coalescer.Add (frame, port.limits, ready);
+          Dispatch (ready);
+        }
+
+      nextExpiry = m_coalescer.Expire (RealtimeNowNs (), ready);
+      Dispatch (ready);
+    }
+}
+
+bool
+RawEmuTrunk::Read (RawFrame &frame)
+{
+  NS_LOG_FUNCTION (this);
+
+  while (true)
+    {
+      uint8_t *buf = (uint8_t *) malloc (m_bufferSize);
+      NS_ABORT_MSG_IF (buf == 0, "malloc() failed");
+
+      struct sockaddr_ll from;
+      struct iovec iov;
+      iov.iov_base = buf;
+      iov.iov_len = m_bufferSize;
+
+      char control[CMSG_SPACE (sizeof (struct timespec)) + CMSG_SPACE (sizeof (struct tpacket_auxdata))];
+
+      struct msghdr msg;
+      std::memset (&msg, 0, sizeof (msg));
+      msg.msg_name = &from;
+      msg.msg_namelen = sizeof (from);
+      msg.msg_iov = &iov;
+      msg.msg_iovlen = 1;
+      msg.msg_control = control;
+      msg.msg_controllen = sizeof (control);
+
+      ssize_t len = recvmsg (m_fd, &msg, MSG_DONTWAIT);
+      int64_t readTime = RealtimeNowNs ();
+      if (len == -1)
+        {
+          if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+              NS_LOG_ERROR ("RawEmuTrunk::Read(): recvmsg() failed: " << std::strerror (errno));
+            }
+          free (buf);
+          return false;
+        }
+
+      // our own transmissions are looped back to the socket; skip them
+      if (from.sll_pkttype == PACKET_OUTGOING)
+        {
+          free (buf);
+          continue;
+        }
+
+      frame = RawFrame ();
+
+      //
+      // A frame larger than the buffer is cut short.  That only happens when
+      // the host merges frames before they get to us (GRO/LRO on the
+      // interface); the port counts and traces it as a drop.
+      //
+      frame.truncated = (msg.msg_flags & MSG_TRUNC) != 0;
+      if (frame.truncated)
+        {
+          NS_LOG_WARN ("RawEmuTrunk::Read(): frame larger than " << m_bufferSize
+                       << " bytes truncated; turn GRO/LRO off on the interface");
+        }
+
+      for (struct cmsghdr *cmsg = CMSG_FIRSTHDR (&msg); cmsg != 0; cmsg = CMSG_NXTHDR (&msg, cmsg))
+        {
+          if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS)
+            {
+              struct timespec ts;
+              std::memcpy (&ts, CMSG_DATA (cmsg), sizeof (ts));
+              frame.arrival = (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+            }
+          else if (cmsg->cmsg_level == SOL_PACKET && cmsg->cmsg_type == PACKET_AUXDATA)
+            {
+              // drivers with VLAN offload strip the tag and report it here
+              struct tpacket_auxdata aux;
+              std::memcpy (&aux, CMSG_DATA (cmsg), sizeof (aux));
+              if ((aux.tp_status & TP_STATUS_VLAN_VALID) || aux.tp_vlan_tci != 0)
+                {
+                  frame.vlanId = aux.tp_vlan_tci & 0x0fff;
+                }
+            }
+        }
+
+      if (frame.arrival != 0)
+        {
+          frame.readWaits.push_back (std::max<int64_t> (readTime - frame.arrival, 0));
+        }
+
+      // otherwise the tag is still in the frame, after the two MAC addresses
+      if (frame.vlanId == 0 && len >= 18 && buf[12] == 0x81 && buf[13] == 0x00)
+        {
+          frame.vlanId = ((buf[14] << 8) | buf[15]) & 0x0fff;
+          std::memmove (buf + 12, buf + 16, len - 16);
+          len -= 4;
+        }
+
+      frame.buffer = buf;
+      frame.size = len;
+      return true;
+    }
+}
+
+void
+RawEmuTrunk::Dispatch (std::vector<RawFrame> &ready)
+{
+  //
+  // The realtime simulator stamps each event with the wall clock time it is
+  // scheduled at, so that is the handover time the IngestWaitTag runs to.
+  //
+  for (std::vector<RawFrame>::iterator i = ready.begin (); i != ready.end (); ++i)
+    {
+      const Port &port = m_ports[i->vlanId];
+      i->handover = RealtimeNowNs ();
+      if (i->truncated)
+        {
+          Simulator::ScheduleWithContext (port.context, Time (0), &RawEmuNetDevice::DropTruncated, port.device, *i);
+        }
+      else
+        {
+          Simulator::ScheduleWithContext (port.context, Time (0), &RawEmuNetDevice::ForwardUp, port.device, *i);
+        }
+    }
+  ready.clear ();
+}
+
+int64_t
+RawEmuTrunk::SendDue (int64_t now)
+{
+  CriticalSection cs (m_mutex);
+  while (!m_pending.empty () && m_pending.begin ()->first <= now)
+    {
+      PendingFrame frame = m_pending.begin ()->second;
+      m_pending.erase (m_pending.begin ());
+      Write (frame.buffer, frame.size);
+      free (frame.buffer);
+    }
+  return m_pending.empty () ? -1 : m_pending.begin ()->first;
+}
+
+bool
+RawEmuTrunk::Send (Ptr<const Packet> frame, uint16_t vlanId, Time delay)
+{
+  NS_LOG_FUNCTION (this << frame << vlanId << delay);
+
+  uint32_t len = frame->GetSize ();
+  uint32_t tagLen = vlanId != 0 ? 4 : 0;
+  uint8_t *buffer = (uint8_t *) malloc (len + tagLen);
+  NS_ABORT_MSG_IF (buffer == 0, "malloc() failed");
+  frame->CopyData (buffer, len);
+
+  if (vlanId != 0)
+    {
+      // insert the 802.1Q tag after the two MAC addresses
+      std::memmove (buffer + 16, buffer + 12, len - 12);
+      buffer[12] = 0x81;
+      buffer[13] = 0x00;
+      buffer[14] = (vlanId >> 8) & 0x0f;
+      buffer[15] = vlanId & 0xff;
+    }
+
+  CriticalSection cs (m_mutex);
+
+  // frames due now go straight out, unless earlier ones are still waiting
+  if (!delay.IsStrictlyPositive () && m_pending.empty ())
+    {
+      bool written = Write (buffer, len + tagLen);
+      free (buffer);
+      return written;
+    }
+
+  PendingFrame pending;
+  pending.buffer = buffer;
+  pending.size = len + tagLen;
+  m_pending.insert (std::make_pair (RealtimeNowNs () + delay.GetNanoSeconds (), pending));
+  Wake ();
+  return true;
+}
+
+bool
+RawEmuTrunk::Write (const uint8_t *buffer, uint32_t size)
+{
+  ssize_t written = send (m_fd, buffer, size, 0);
+  if (written != (ssize_t) size)
+    {
+      NS_LOG_ERROR ("RawEmuTrunk::Write(): send() failed: " << std::strerror (errno));
+      return false;
+    }
+  return true;
+}
+
+//
+// RawEmuNetDevice
+//
+
+TypeId
+RawEmuNetDevice::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::RawEmuNetDevice")
+    .SetParent<NetDevice> ()
+    .SetGroupName ("SwitchedEthernet")
+    .AddConstructor<RawEmuNetDevice> ()
+    .AddAttribute ("Address",
+                   "The MAC address of this device.",
+                   Mac48AddressValue (Mac48Address ("ff:ff:ff:ff:ff:ff")),
+                   MakeMac48AddressAccessor (&RawEmuNetDevice::m_address),
+                   MakeMac48AddressChecker ())
+    .AddAttribute ("Mtu", "The MAC-level Maximum Transmission Unit",
+                   UintegerValue (1500),
+                   MakeUintegerAccessor (&RawEmuNetDevice::SetMtu,
+                                         &RawEmuNetDevice::GetMtu),
+                   MakeUintegerChecker<uint16_t> ())
+    .AddAttribute ("CoalesceDataRate",
+                   "Rate of the link frames from this port go on to.  Bulk TCP segments that "
+                   "arrive while that link, sending the port's frames one by one at this rate, "
+                   "would still be busy with the segment before are merged before they enter "
+                   "the simulator; 0 turns merging off.  Raise Mtu to match.",
+                   DataRateValue (DataRate (0)),
+                   MakeDataRateAccessor (&RawEmuNetDevice::m_coalesceDataRate),
+                   MakeDataRateChecker ())
+    .AddAttribute ("CoalesceMaxSize",
+                   "Largest IPv4 packet to merge segments into.",
+                   UintegerValue (65000),
+                   MakeUintegerAccessor (&RawEmuNetDevice::m_coalesceMaxSize),
+                   MakeUintegerChecker<uint32_t> (0, 65535))
+    .AddAttribute ("CoalesceMaxHold",
+                   "Longest time to hold the first segment of a merged packet for more.  Up to "
+                   "the link's propagation delay plus one frame time, merged packets are not "
+                   "late; the default is safe for links of 1 ms or more, set it to that bound "
+                   "to merge more.",
+                   TimeValue (MilliSeconds (1)),
+                   MakeTimeAccessor (&RawEmuNetDevice::m_coalesceMaxHold),
+                   MakeTimeChecker (Seconds (0), Seconds (1)))
+    .AddAttribute ("IngestWaitBinWidth",
+                   "Bin width of the ingest wait histogram.",
+                   TimeValue (MicroSeconds (10)),
+                   MakeTimeAccessor (&RawEmuNetDevice::m_ingestWaitBinWidth),
+                   MakeTimeChecker ())
+    .AddTraceSource ("IngestWait",
+                     "Time a received frame spent between kernel receive and the socket read",
+                     MakeTraceSourceAccessor (&RawEmuNetDevice::m_ingestWaitTrace),
+                     "ns3::Time::TracedCallback")
+    .AddTraceSource ("MacTx",
+                     "A packet has been accepted by the device for transmission",
+                     MakeTraceSourceAccessor (&RawEmuNetDevice::m_macTxTrace),
+                     "ns3::Packet::TracedCallback")
+    .AddTraceSource ("MacTxDrop",
+                     "A packet has been dropped by the device before transmission",
+                     MakeTraceSourceAccessor (&RawEmuNetDevice::m_macTxDropTrace),
+                     "ns3::Packet::TracedCallback")
+    .AddTraceSource ("MacRxDrop",
+                     "A frame read from the host was too large for the device and has been dropped",
+                     MakeTraceSourceAccessor (&RawEmuNetDevice::m_macRxDropTrace),
+                     "ns3::Packet::TracedCallback")
+    .AddTraceSource ("MacRx",
+                     "A packet has been received by the device and is being forwarded up",
+                     MakeTraceSourceAccessor (&RawEmuNetDevice::m_macRxTrace),
+                     "ns3::Packet::TracedCallback")
+    .AddTraceSource ("Sniffer",
+                     "Trace source simulating a non-promiscuous packet sniffer attached to the device",
+                     MakeTraceSourceAccessor (&RawEmuNetDevice::m_snifferTrace),
+                     "ns3::Packet::TracedCallback")
+    .AddTraceSource ("PromiscSniffer",
+                     "Trace source simulating a promiscuous packet sniffer attached to the device",
+                     MakeTraceSourceAccessor (&RawEmuNetDevice::m_promiscSnifferTrace),
+                     "ns3::Packet::TracedCallback")
+  ;
+  return tid;
+}
+
+RawEmuNetDevice::RawEmuNetDevice ()
+  : m_node (0),
+    m_trunk (0),
+    m_vlanId (0),
+    m_ifIndex (0),
+    m_mtu (1500),
+    m_coalesceMaxSize (65000),
+    m_rxSegments (0),
+    m_rxPackets (0),
+    m_ingestWaitMin (0),
+    m_ingestWaitMax (0),
+    m_ingestWaitSum (0),
+    m_ingestWaitCount (0),
+    m_truncatedFrames (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+RawEmuNetDevice::~RawEmuNetDevice ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+RawEmuNetDevice::SetTrunk (Ptr<RawEmuTrunk> trunk, uint16_t vlanId)
+{
+  NS_LOG_FUNCTION (this << trunk << vlanId);
+  NS_ABORT_MSG_IF (m_node == 0, "RawEmuNetDevice::SetTrunk(): add the device to a node first");
+  m_trunk = trunk;
+  m_vlanId = vlanId;
+  m_trunk->AddPort (vlanId, this);
+}
+
+uint16_t
+RawEmuNetDevice::GetVlanId (void) const
+{
+  return m_vlanId;
+}
+
+FrameCoalescer::Limits
+RawEmuNetDevice::GetCoalescingLimits (void) const
+{
+  FrameCoalescer::Limits limits;
+  limits.bitRate = m_coalesceDataRate.GetBitRate ();
+  limits.maxSize = m_coalesceMaxSize;
+  limits.maxHold = m_coalesceMaxHold.GetNanoSeconds ();
+  return limits;
+}
+
+void
+RawEmuNetDevice::DoInitialize (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ABORT_MSG_IF (m_trunk == 0, "RawEmuNetDevice::DoInitialize(): no trunk set");
+
+  m_ingestWait.SetDefaultBinWidth (m_ingestWaitBinWidth.GetSeconds ());
+
+  m_trunk->Start ();
+
+  NetDevice::DoInitialize ();
+}
+
+void
+RawEmuNetDevice::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  if (m_trunk != 0)
+    {
+      m_trunk->Stop ();
+      m_trunk = 0;
+    }
+
+  m_node = 0;
+  m_rxCallback = MakeNullCallback<bool, Ptr<NetDevice>, Ptr<const Packet>, uint16_t, const Address &> ();
+  m_promiscRxCallback = MakeNullCallback<bool, Ptr<NetDevice>, Ptr<const Packet>, uint16_t, const Address &, const Address &, enum PacketType> ();
+  NetDevice::DoDispose ();
+}
+
+void
+RawEmuNetDevice::ForwardUp (RawFrame frame)
+{
+  NS_LOG_FUNCTION (this << frame.size << frame.segments);
+
+  Ptr<Packet> packet = Create<Packet> (reinterpret_cast<const uint8_t *> (frame.buffer), frame.size);
+  free (frame.buffer);
+  frame.buffer = 0;
+
+  m_rxSegments += frame.segments;
+  m_rxPackets++;
+
+  // one sample per frame read, merged or not
+  for (std::vector<int64_t>::const_iterator i = frame.readWaits.begin (); i != frame.readWaits.end (); ++i)
+    {
+      RecordIngestWait (NanoSeconds (*i));
+    }
+
+  //
+  // The realtime simulator stamps an event scheduled from the trunk thread
+  // with the wall clock time it was scheduled at, i.e. the handover.  Only
+  // the time before the handover is lost to the model: the time in the
+  // socket buffer and, for merged segments, the time the first one was
+  // held for the others.  However late this event runs after that does
+  // not add to simulated time.
+  //
+  if (frame.arrival != 0)
+    {
+      Time wait = NanoSeconds (frame.handover - frame.arrival);
+      if (wait.IsStrictlyNegative ())
+        {
+          wait = Seconds (0);
+        }
+
+      IngestWaitTag tag;
+      tag.SetWait (wait);
+      packet->AddPacketTag (tag);
+    }
+
+  if (frame.segments > 1)
+    {
+      CoalescedSegmentsTag tag;
+      tag.SetSegments (frame.segments);
+      tag.SetSegmentSize (frame.segmentSize);
+      tag.SetHeaderBytes (frame.headerBytes);
+      packet->AddPacketTag (tag);
+    }
+
+  Ptr<Packet> originalPacket = packet->Copy ();
+
+  EthernetHeader header (false);
+  if (packet->GetSize () < header.GetSerializedSize ())
+    {
+      return;
+    }
+  packet->RemoveHeader (header);
+
+  Mac48Address from = header.GetSource ();
+  Mac48Address to = header.GetDestination ();
+  uint16_t protocol = header.GetLengthType ();
+
+  NetDevice::PacketType packetType;
+  if (to == m_address)
+    {
+      packetType = NetDevice::PACKET_HOST;
+    }
+  else if (to.IsBroadcast ())
+    {
+      packetType = NetDevice::PACKET_BROADCAST;
+    }
+  else if (to.IsGroup ())
+    {
+      packetType = NetDevice::PACKET_MULTICAST;
+    }
+  else
+    {
+      packetType = NetDevice::PACKET_OTHERHOST;
+    }
+
+  m_promiscSnifferTrace (originalPacket);
+  if (!m_promiscRxCallback.IsNull ())
+    {
+      m_promiscRxCallback (this, packet, protocol, from, to, packetType);
+    }
+
+  if (packetType != NetDevice::PACKET_OTHERHOST)
+    {
+      m_snifferTrace (originalPacket);
+      m_macRxTrace (originalPacket);
+      m_rxCallback (this, packet, protocol, from);
+    }
+}
+
+void
+RawEmuNetDevice::RecordIngestWait (Time wait)
+{
+  double seconds = wait.GetSeconds ();
+  m_ingestWait.AddValue (seconds);
+  m_ingestWaitMin = (m_ingestWaitCount == 0 || seconds < m_ingestWaitMin) ? seconds : m_ingestWaitMin;
+  m_ingestWaitMax = (m_ingestWaitCount == 0 || seconds > m_ingestWaitMax) ? seconds : m_ingestWaitMax;
+  m_ingestWaitSum += seconds;
+  m_ingestWaitCount++;
+  m_ingestWaitTrace (wait);
+}
+
+void
+RawEmuNetDevice::DropTruncated (RawFrame frame)
+{
+  NS_LOG_FUNCTION (this << frame.size);
+
+  Ptr<Packet> packet = Create<Packet> (reinterpret_cast<const uint8_t *> (frame.buffer), frame.size);
+  free (frame.buffer);
+
+  m_truncatedFrames++;
+  m_macRxDropTrace (packet);
+}
+
+uint64_t
+RawEmuNetDevice::GetTruncatedFrames (void) const
+{
+  return m_truncatedFrames;
+}
+
+uint64_t
+RawEmuNetDevice::GetReceivedSegments (void) const
+{
+  return m_rxSegments;
+}
+
+uint64_t
+RawEmuNetDevice::GetReceivedPackets (void) const
+{
+  return m_rxPackets;
+}
+
+void
+RawEmuNetDevice::PrintIngestWait (std::ostream &os) const
+{
+  os << "ingest wait: " << m_ingestWaitCount << " frames";
+  if (m_ingestWaitCount == 0)
+    {
+      os << std::endl;
+      return;
+    }
+
+  os << ", mean " << m_ingestWaitSum / m_ingestWaitCount * 1e6 << " us"
+     << ", min " << m_ingestWaitMin * 1e6 << " us"
+     << ", max " << m_ingestWaitMax * 1e6 << " us";
+
+  //
+  // Percentiles are read off the histogram, so they are accurate to one
+  // bin width.
+  //
+  const double percentiles[] = { 0.50, 0.90, 0.99 };
+  uint32_t next = 0;
+  uint64_t seen = 0;
+  for (uint32_t i = 0; i < m_ingestWait.GetNBins () && next < 3; ++i)
+    {
+      seen += m_ingestWait.GetBinCount (i);
+      while (next < 3 && seen >= percentiles[next] * m_ingestWaitCount)
+        {
+          os << ", p" << (uint32_t) (percentiles[next] * 100) << " "
+             << m_ingestWait.GetBinEnd (i) * 1e6 << " us";
+          next++;
+        }
+    }
+  os << std::endl;
+
+  for (uint32_t i = 0; i < m_ingestWait.GetNBins (); ++i)
+    {
+      if (m_ingestWait.GetBinCount (i) != 0)
+        {
+          os << "  [" << m_ingestWait.GetBinStart (i) * 1e6 << ", "
+             << m_ingestWait.GetBinEnd (i) * 1e6 << ") us: "
+             << m_ingestWait.GetBinCount (i) << std::endl;
+        }
+    }
+}
+
+bool
+RawEmuNetDevice::Send (Ptr<Packet> packet, const Address& dest, uint16_t protocolNumber)
+{
+  NS_LOG_FUNCTION (this << packet << dest << protocolNumber);
+  return SendFrom (packet, m_address, dest, protocolNumber);
+}
+
+bool
+RawEmuNetDevice::SendFrom (Ptr<Packet> packet, const Address& source, const Address& dest, uint16_t protocolNumber)
+{
+  NS_LOG_FUNCTION (this << packet << source << dest << protocolNumber);
+
+  if (packet->GetSize () > m_mtu)
+    {
+      m_macTxDropTrace (packet);
+      return false;
+    }
+
+  //
+  // Merged segments leave as the frames they came in as, spaced the way
+  // the channel would have delivered them one by one.
+  //
+  CoalescedSegmentsTag tag;
+  if (protocolNumber == 0x0800 && packet->PeekPacketTag (tag))
+    {
+      std::vector<Ptr<Packet> > segments;
+      std::vector<Time> offsets;
+      SegmentSplitter::Split (packet, segments, offsets);
+
+      bool sent = true;
+      for (uint32_t i = 0; i < segments.size (); ++i)
+        {
+          sent = SendFrame (segments[i], source, dest, protocolNumber, offsets[i]) && sent;
+        }
+      return sent;
+    }
+
+  return SendFrame (packet, source, dest, protocolNumber, Seconds (0));
+}
+
+bool
+RawEmuNetDevice::SendFrame (Ptr<Packet> packet, const Address& source, const Address& dest, uint16_t protocolNumber, Time delay)
+{
+  NS_LOG_FUNCTION (this << packet << source << dest << protocolNumber << delay);
+
+  EthernetHeader header (false);
+  header.SetSource (Mac48Address::ConvertFrom (source));
+  header.SetDestination (Mac48Address::ConvertFrom (dest));
+  header.SetLengthType (protocolNumber);
+  packet->AddHeader (header);
+
+  m_macTxTrace (packet);
+  m_snifferTrace (packet);
+  m_promiscSnifferTrace (packet);
+
+  if (!m_trunk->Send (packet, m_vlanId, delay))
+    {
+      m_macTxDropTrace (packet);
+      return false;
+    }
+  return true;
+}
+
+void
+RawEmuNetDevice::SetIfIndex (const uint32_t index)
+{
+  m_ifIndex = index;
+}
+
+uint32_t
+RawEmuNetDevice::GetIfIndex (void) const
+{
+  return m_ifIndex;
+}
+
+Ptr<Channel>
+RawEmuNetDevice::GetChannel (void) const
+{
+  return 0;
+}
+
+void
+RawEmuNetDevice::SetAddress (Address address)
+{
+  m_address = Mac48Address::ConvertFrom (address);
+}
+
+Address
+RawEmuNetDevice::GetAddress (void) const
+{
+  return m_address;
+}
+
+bool
+RawEmuNetDevice::SetMtu (const uint16_t mtu)
+{
+  m_mtu = mtu;
+  return true;
+}
+
+uint16_t
+RawEmuNetDevice::GetMtu (void) const
+{
+  return m_mtu;
+}
+
+bool
+RawEmuNetDevice::IsLinkUp (void) const
+{
+  return true;
+}
+
+void
+RawEmuNetDevice::AddLinkChangeCallback (Callback<void> callback)
+{
+}
+
+bool
+RawEmuNetDevice::IsBroadcast (void) const
+{
+  return true;
+}
+
+Address
+RawEmuNetDevice::GetBroadcast (void) const
+{
+  return Mac48Address::GetBroadcast ();
+}
+
+bool
+RawEmuNetDevice::IsMulticast (void) const
+{
+  return true;
+}
+
+Address
+RawEmuNetDevice::GetMulticast (Ipv4Address multicastGroup) const
+{
+  return Mac48Address::GetMulticast (multicastGroup);
+}
+
+Address
+RawEmuNetDevice::GetMulticast (Ipv6Address addr) const
+{
+  return Mac48Address::GetMulticast (addr);
+}
+
+bool
+RawEmuNetDevice::IsBridge (void) const
+{
+  return false;
+}
+
+bool
+RawEmuNetDevice::IsPointToPoint (void) const
+{
+  return false;
+}
+
+Ptr<Node>
+RawEmuNetDevice::GetNode (void) const
+{
+  return m_node;
+}
+
+void
+RawEmuNetDevice::SetNode (Ptr<Node> node)
+{
+  m_node = node;
+}
+
+bool
+RawEmuNetDevice::NeedsArp (void) const
+{
+  return true;
+}
+
+void
+RawEmuNetDevice::SetReceiveCallback (NetDevice::ReceiveCallback cb)
+{
+  m_rxCallback = cb;
+}
+
+void
+RawEmuNetDevice::SetPromiscReceiveCallback (NetDevice::PromiscReceiveCallback cb)
+{
+  m_promiscRxCallback = cb;
+}
+
+bool
+RawEmuNetDevice::SupportsSendFrom (void) const
+{
+  return true;
+}
+
+//
+// RawEmuNetDeviceHelper
+//
+
+RawEmuNetDeviceHelper::RawEmuNetDeviceHelper ()
+  : m_deviceName ("undefined")
+{
+  m_deviceFactory.SetTypeId ("ns3::RawEmuNetDevice");
+}
+
+void
+RawEmuNetDeviceHelper::SetDeviceName (std::string deviceName)
+{
+  m_deviceName = deviceName;
+}
+
+void
+RawEmuNetDeviceHelper::SetAttribute (std::string n1, const AttributeValue &v1)
+{
+  m_deviceFactory.Set (n1, v1);
+}
+
+NetDeviceContainer
+RawEmuNetDeviceHelper::Install (Ptr<Node> node) const
+{
+  return NetDeviceContainer (InstallPriv (node, 0));
+}
+
+NetDeviceContainer
+RawEmuNetDeviceHelper::Install (Ptr<Node> node, uint16_t vlanId) const
+{
+  return NetDeviceContainer (InstallPriv (node, vlanId));
+}
+
+NetDeviceContainer
+RawEmuNetDeviceHelper::Install (const NodeContainer &c, uint16_t firstVlanId) const
+{
+  NetDeviceContainer devices;
+  uint16_t vlanId = firstVlanId;
+  for (NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+    {
+      devices.Add (InstallPriv (*i, vlanId++));
+    }
+  return devices;
+}
+
+Ptr<NetDevice>
+RawEmuNetDeviceHelper::InstallPriv (Ptr<Node> node, uint16_t vlanId) const
+{
+  Ptr<RawEmuNetDevice> device = m_deviceFactory.Create<RawEmuNetDevice> ();
+  device->SetAddress (Mac48Address::Allocate ());
+  node->AddDevice (device);
+  device->SetTrunk (GetTrunk (), vlanId);
+  return device;
+}
+
+Ptr<RawEmuTrunk>
+RawEmuNetDeviceHelper::GetTrunk (void) const
+{
+  if (m_trunk == 0)
+    {
+      int fd = CreateFileDescriptor ();
+      m_trunk = Create<RawEmuTrunk> ();
+      m_trunk->SetFileDescriptor (fd);
+      m_trunk->SetBufferSize (GetBufferSize (fd));
+    }
+  return m_trunk;
+}
+
+uint32_t
+RawEmuNetDeviceHelper::GetBufferSize (int fd) const
+{
+  NS_LOG_FUNCTION (this << fd);
+
+  //
+  // The read buffer follows the host interface, not the ns-3 Mtu, which
+  // may be raised for merged packets: an Ethernet frame plus an 802.1Q tag
+  // and the FCS.
+  //
+  struct ifreq ifr;
+  std::memset (&ifr, 0, sizeof (ifr));
+  std::strncpy (ifr.ifr_name, m_deviceName.c_str (), IFNAMSIZ - 1);
+  NS_ABORT_MSG_IF (ioctl (fd, SIOCGIFMTU, &ifr) == -1,
+                   "RawEmuNetDeviceHelper::GetBufferSize(): cannot get the MTU of " << m_deviceName
+                   << ": " << std::strerror (errno));
+  return ifr.ifr_mtu + 22;
+}
+
+int
+RawEmuNetDeviceHelper::CreateFileDescriptor (void) const
+{
+  NS_LOG_FUNCTION (this);
+
+  int fd = socket (PF_PACKET, SOCK_RAW, htons (ETH_P_ALL));
+  NS_ABORT_MSG_IF (fd == -1, "RawEmuNetDeviceHelper::CreateFileDescriptor(): socket() failed: "
+                   << std::strerror (errno) << " (the program needs CAP_NET_RAW)");
+
+  struct ifreq ifr;
+  std::memset (&ifr, 0, sizeof (ifr));
+  std::strncpy (ifr.ifr_name, m_deviceName.c_str (), IFNAMSIZ - 1);
+  NS_ABORT_MSG_IF (ioctl (fd, SIOCGIFINDEX, &ifr) == -1,
+                   "RawEmuNetDeviceHelper::CreateFileDescriptor(): no such device " << m_deviceName);
+
+  struct sockaddr_ll ll;
+  std::memset (&ll, 0, sizeof (ll));
+  ll.sll_family = AF_PACKET;
+  ll.sll_ifindex = ifr.ifr_ifindex;
+  ll.sll_protocol = htons (ETH_P_ALL);
+  NS_ABORT_MSG_IF (bind (fd, (struct sockaddr *) &ll, sizeof (ll)) == -1,
+                   "RawEmuNetDeviceHelper::CreateFileDescriptor(): bind() failed: " << std::strerror (errno));
+
+  //
+  // We spoof our own MAC address, so the interface has to hand us frames
+  // that are not addressed to it.
+  //
+  struct packet_mreq mreq;
+  std::memset (&mreq, 0, sizeof (mreq));
+  mreq.mr_ifindex = ifr.ifr_ifindex;
+  mreq.mr_type = PACKET_MR_PROMISC;
+  NS_ABORT_MSG_IF (setsockopt (fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof (mreq)) == -1,
+                   "RawEmuNetDeviceHelper::CreateFileDescriptor(): cannot set " << m_deviceName
+                   << " promiscuous: " << std::strerror (errno));
+
+  // software receive timestamps; no NIC support needed
+  int on = 1;
+  NS_ABORT_MSG_IF (setsockopt (fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof (on)) == -1,
+                   "RawEmuNetDeviceHelper::CreateFileDescriptor(): SO_TIMESTAMPNS failed: " << std::strerror (errno));
+
+  // VLAN ids of frames whose tag the driver stripped
+  NS_ABORT_MSG_IF (setsockopt (fd, SOL_PACKET, PACKET_AUXDATA, &on, sizeof (on)) == -1,
+                   "RawEmuNetDeviceHelper::CreateFileDescriptor(): PACKET_AUXDATA failed: " << std::strerror (errno));
+
+  return fd;
+}
+
+void
+RawEmuNetDeviceHelper::EnablePcapInternal (std::string prefix, Ptr<NetDevice> nd, bool promiscuous, bool explicitFilename)
+{
+  Ptr<RawEmuNetDevice> device = nd->GetObject<RawEmuNetDevice> ();
+  if (device == 0)
+    {
+      NS_LOG_INFO ("RawEmuNetDeviceHelper::EnablePcapInternal(): Device " << device << " not of type ns3::RawEmuNetDevice");
+      return;
+    }
+
+  PcapHelper pcapHelper;
+
+  std::string filename;
+  if (explicitFilename)
+    {
+      filename = prefix;
+    }
+  else
+    {
+      filename = pcapHelper.GetFilenameFromDevice (prefix, device);
+    }
+
+  Ptr<PcapFileWrapper> file = pcapHelper.CreateFile (filename, std::ios::out,
+                                                     PcapHelper::DLT_EN10MB);
+  if (promiscuous)
+    {
+      pcapHelper.HookDefaultSink<RawEmuNetDevice> (device, "PromiscSniffer", file);
+    }
+  else
+    {
+      pcapHelper.HookDefaultSink<RawEmuNetDevice> (device, "Sniffer", file);
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,344 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef RAW_EMU_NET_DEVICE_H
+#define RAW_EMU_NET_DEVICE_H
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "ns3/net-device.h"
+#include "ns3/node.h"
+#include "ns3/node-container.h"
+#include "ns3/net-device-container.h"
+#include "ns3/mac48-address.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/object-factory.h"
+#include "ns3/traced-callback.h"
+#include "ns3/trace-helper.h"
+#include "ns3/simple-ref-count.h"
+#include "ns3/system-thread.h"
+#include "ns3/system-mutex.h"
+#include "ns3/data-rate.h"
+#include "ns3/histogram.h"
+
+#include "segment-offload.h"
+#include "ingest-wait-tag.h"
+
+namespace ns3 {
+
+//
+// An emu device on a raw packet socket that knows when frames really
+// arrived.
+//
+// EmuFdNetDevice stamps a frame when the simulator thread gets to it, so
+// whatever time the frame sat in the socket buffer is silently added to the
+// delay the channel model applies.  This device asks the kernel for a
+// software receive timestamp on every frame (SO_TIMESTAMPNS, which works on
+// veth and any other interface without NIC support) and measures the
+// ingest wait from that timestamp to the moment the frame is read off the
+// socket.  The time up to the frame's handover to the simulator, which for
+// merged segments includes the time they were held, goes with the packet
+// in an IngestWaitTag.  Channels that understand the tag start sending the
+// frame from its arrival time, not its handover time, and leave their
+// propagation delay alone.
+//
+// The socket belongs to a RawEmuTrunk, which can carry many devices at
+// once: each device is a port on one 802.1Q VLAN of the trunk interface,
+// or the untagged port.  One trunk thread serves every port; frames are
+// dispatched by VLAN id through a table indexed directly by the id, and
+// tagged with the port's id on the way out.
+//
+// A port with a CoalesceDataRate has bulk TCP merged by the trunk thread
+// before it becomes an event (see segment-offload.h), and splits such
+// packets back into their segments on the way out.  The trunk thread
+// writes the segments at the spacing the channel gave them.
+//
+// The socket is opened directly, so the program needs CAP_NET_RAW
+// (run it with sudo, or setcap cap_net_raw+ep on the binary).
+//
+
+class RawEmuNetDevice;
+
+/**
+ * A packet socket on a host interface, shared by the RawEmuNetDevices that
+ * are ports on it.  A thread of its own reads frames, their kernel receive
+ * timestamps and their VLAN ids off the socket, merges bulk TCP for the
+ * ports that ask for it, and writes the frames that are due later.
+ */
+class RawEmuTrunk : public SimpleRefCount<RawEmuTrunk>
+{
+public:
+  /** Number of entries in the dispatch table: every 12-bit VLAN id. */
+  static const uint16_t VLAN_IDS = 4096;
+
+  RawEmuTrunk ();
+  ~RawEmuTrunk ();
+
+  /**
+   * Set the packet socket to use.  The trunk owns it from then on.
+   */
+  void SetFileDescriptor (int fd);
+
+  /**
+   * Set the size of the read buffer: the largest frame the host interface
+   * can receive, 802.1Q tag included.
+   */
+  void SetBufferSize (uint32_t bufferSize);
+
+  /**
+   * Make a device the port for a VLAN id; 0 is the untagged port.
+   */
+  void AddPort (uint16_t vlanId, Ptr<RawEmuNetDevice> device);
+
+  /**
+   * Start the trunk thread, if not already started.  Every port calls
+   * this; the coalescing limits of all ports are taken at that point.
+   */
+  void Start (void);
+
+  /**
+   * Stop the trunk thread, drop the frames it still holds, close the
+   * socket and forget the ports.  Every port calls this; only the first
+   * call does anything.
+   */
+  void Stop (void);
+
+  /**
+   * Write a frame out of the trunk, tagged with the VLAN id unless it is 0,
+   * delay from now.  Frames go out in the order they are due.
+   */
+  bool Send (Ptr<const Packet> frame, uint16_t vlanId, Time delay);
+
+private:
+  /** Body of the trunk thread. */
+  void Run (void);
+
+  /** Read a frame off the socket without blocking; false if there is none. */
+  bool Read (RawFrame &frame);
+
+  /** Hand frames to their ports.  Runs in the trunk thread. */
+  void Dispatch (std::vector<RawFrame> &ready);
+
+  /**
+   * Write every frame due by now.  Runs in the trunk thread.
+   *
+   * \returns the time the next frame is due, or -1 if none is pending
+   */
+  int64_t SendDue (int64_t now);
+
+  bool Write (const uint8_t *buffer, uint32_t size);
+
+  /** Make the trunk thread look at its state again. */
+  void Wake (void);
+
+  //
+  // The trunk thread hands the device to events it schedules.  A Ptr
+  // would be copied into the event there and released in the simulator
+  // thread, racing on the non-atomic reference count, so the table holds
+  // plain pointers.  The devices outlive the table: the first of them to
+  // be disposed stops the trunk.
+  //
+  struct Port
+  {
+    Port () : device (0), context (0) {}
+    RawEmuNetDevice *device;
+    uint32_t context;
+    FrameCoalescer::Limits limits;
+  };
+
+  struct PendingFrame
+  {
+    uint8_t *buffer;
+    uint32_t size;
+  };
+
+  int m_fd;
+  int m_wakeFds[2];                   // pipe; the trunk thread polls the read end
+  uint32_t m_bufferSize;
+  Ptr<SystemThread> m_thread;
+  std::vector<Port> m_ports;          // indexed by VLAN id
+  FrameCoalescer m_coalescer;         // trunk thread only
+
+  SystemMutex m_mutex;                // guards the members below and socket writes
+  bool m_stop;
+  std::multimap<int64_t, PendingFrame> m_pending;     // by due time, ns since the epoch
+};
+
+/**
+ * A NetDevice bound to a host interface through a raw packet socket.
+ */
+class RawEmuNetDevice : public NetDevice
+{
+public:
+  static TypeId GetTypeId (void);
+
+  RawEmuNetDevice ();
+  virtual ~RawEmuNetDevice ();
+
+  /**
+   * Make the device the port for a VLAN id of a trunk; 0 is the untagged
+   * port.
+   */
+  void SetTrunk (Ptr<RawEmuTrunk> trunk, uint16_t vlanId);
+  uint16_t GetVlanId (void) const;
+
+  /** How the trunk may merge frames for this port. */
+  FrameCoalescer::Limits GetCoalescingLimits (void) const;
+
+  /**
+   * Called by the trunk, in the simulator thread, with a frame, possibly
+   * merged, for this port.  The device owns the buffer from then on.
+   */
+  void ForwardUp (RawFrame frame);
+
+  /**
+   * Called by the trunk, in the simulator thread, with a frame for this
+   * port that did not fit the read buffer.  The frame is counted and
+   * handed to the MacRxDrop trace.
+   */
+  void DropTruncated (RawFrame frame);
+
+  /** Frames dropped because they did not fit the read buffer. */
+  uint64_t GetTruncatedFrames (void) const;
+
+  /** Frames read off the host for this port, counting merged ones one by one. */
+  uint64_t GetReceivedSegments (void) const;
+
+  /** Packets forwarded up after merging. */
+  uint64_t GetReceivedPackets (void) const;
+
+  /**
+   * Print how long frames waited between kernel receive and the socket
+   * read, one sample per frame read whether it was merged or not: count,
+   * mean, extremes, percentiles and the histogram itself.
+   */
+  void PrintIngestWait (std::ostream &os) const;
+
+  // inherited from NetDevice
+  virtual void SetIfIndex (const uint32_t index);
+  virtual uint32_t GetIfIndex (void) const;
+  virtual Ptr<Channel> GetChannel (void) const;
+  virtual void SetAddress (Address address);
+  virtual Address GetAddress (void) const;
+  virtual bool SetMtu (const uint16_t mtu);
+  virtual uint16_t GetMtu (void) const;
+  virtual bool IsLinkUp (void) const;
+  virtual void AddLinkChangeCallback (Callback<void> callback);
+  virtual bool IsBroadcast (void) const;
+  virtual Address GetBroadcast (void) const;
+  virtual bool IsMulticast (void) const;
+  virtual Address GetMulticast (Ipv4Address multicastGroup) const;
+  virtual Address GetMulticast (Ipv6Address addr) const;
+  virtual bool IsBridge (void) const;
+  virtual bool IsPointToPoint (void) const;
+  virtual bool Send (Ptr<Packet> packet, const Address& dest, uint16_t protocolNumber);
+  virtual bool SendFrom (Ptr<Packet> packet, const Address& source, const Address& dest, uint16_t protocolNumber);
+  virtual Ptr<Node> GetNode (void) const;
+  virtual void SetNode (Ptr<Node> node);
+  virtual bool NeedsArp (void) const;
+  virtual void SetReceiveCallback (NetDevice::ReceiveCallback cb);
+  virtual void SetPromiscReceiveCallback (NetDevice::PromiscReceiveCallback cb);
+  virtual bool SupportsSendFrom (void) const;
+
+protected:
+  virtual void DoInitialize (void);
+  virtual void DoDispose (void);
+
+private:
+  void RecordIngestWait (Time wait);
+  bool SendFrame (Ptr<Packet> packet, const Address& source, const Address& dest, uint16_t protocolNumber, Time delay);
+
+  Ptr<Node> m_node;
+  Ptr<RawEmuTrunk> m_trunk;
+  uint16_t m_vlanId;
+  Mac48Address m_address;
+  uint32_t m_ifIndex;
+  uint16_t m_mtu;
+
+  DataRate m_coalesceDataRate;
+  uint32_t m_coalesceMaxSize;
+  Time m_coalesceMaxHold;
+  uint64_t m_rxSegments;
+  uint64_t m_rxPackets;
+
+  Time m_ingestWaitBinWidth;
+  Histogram m_ingestWait;
+  double m_ingestWaitMin;
+  double m_ingestWaitMax;
+  double m_ingestWaitSum;
+  uint64_t m_ingestWaitCount;
+  uint64_t m_truncatedFrames;
+
+  NetDevice::ReceiveCallback m_rxCallback;
+  NetDevice::PromiscReceiveCallback m_promiscRxCallback;
+
+  TracedCallback<Time> m_ingestWaitTrace;
+  TracedCallback<Ptr<const Packet> > m_macTxTrace;
+  TracedCallback<Ptr<const Packet> > m_macTxDropTrace;
+  TracedCallback<Ptr<const Packet> > m_macRxDropTrace;
+  TracedCallback<Ptr<const Packet> > m_macRxTrace;
+  TracedCallback<Ptr<const Packet> > m_snifferTrace;
+  TracedCallback<Ptr<const Packet> > m_promiscSnifferTrace;
+};
+
+/**
+ * Build RawEmuNetDevices, the same way EmuFdNetDeviceHelper builds
+ * FdNetDevices.  All devices installed by one helper share one trunk on
+ * the helper's host interface.
+ */
+class RawEmuNetDeviceHelper : public PcapHelperForDevice
+{
+public:
+  RawEmuNetDeviceHelper ();
+  virtual ~RawEmuNetDeviceHelper () {}
+
+  /** Host interface to attach to, e.g. enp0s8. */
+  void SetDeviceName (std::string deviceName);
+
+  void SetAttribute (std::string n1, const AttributeValue &v1);
+
+  /** Install the untagged port. */
+  NetDeviceContainer Install (Ptr<Node> node) const;
+
+  /** Install the port for one VLAN. */
+  NetDeviceContainer Install (Ptr<Node> node, uint16_t vlanId) const;
+
+  /**
+   * Install one port per node, on consecutive VLANs starting at
+   * firstVlanId.
+   */
+  NetDeviceContainer Install (const NodeContainer &c, uint16_t firstVlanId) const;
+
+private:
+  Ptr<NetDevice> InstallPriv (Ptr<Node> node, uint16_t vlanId) const;
+  Ptr<RawEmuTrunk> GetTrunk (void) const;
+  int CreateFileDescriptor (void) const;
+  uint32_t GetBufferSize (int fd) const;
+
+  virtual void EnablePcapInternal (std::string prefix, Ptr<NetDevice> nd, bool promiscuous, bool explicitFilename);
+
+  std::string m_deviceName;
+  ObjectFactory m_deviceFactory;
+  mutable Ptr<RawEmuTrunk> m_trunk;
+};
+
+} // namespace ns3
+
+#endif /* RAW_EMU_NET_DEVICE_H */
@@ -0,0 +1,571 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "segment-offload.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/node.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/tcp-header.h"
+#include "ns3/tcp-l4-protocol.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("SegmentOffload");
+
+NS_OBJECT_ENSURE_REGISTERED (CoalescedSegmentsTag);
+
+//
+// CoalescedSegmentsTag
+//
+
+TypeId
+CoalescedSegmentsTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CoalescedSegmentsTag")
+    .SetParent<Tag> ()
+    .SetGroupName ("SwitchedEthernet")
+    .AddConstructor<CoalescedSegmentsTag> ()
+  ;
+  return tid;
+}
+
+TypeId
+CoalescedSegmentsTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+CoalescedSegmentsTag::CoalescedSegmentsTag ()
+  : m_segments (1),
+    m_segmentSize (0),
+    m_headerBytes (0),
+    m_spacing (0),
+    m_lastSpacing (0)
+{
+}
+
+uint32_t
+CoalescedSegmentsTag::GetSerializedSize (void) const
+{
+  return 2 + 2 + 1 + 8 + 8;
+}
+
+void
+CoalescedSegmentsTag::Serialize (TagBuffer i) const
+{
+  i.WriteU16 (m_segments);
+  i.WriteU16 (m_segmentSize);
+  i.WriteU8 (m_headerBytes);
+  i.WriteU64 (m_spacing);
+  i.WriteU64 (m_lastSpacing);
+}
+
+void
+CoalescedSegmentsTag::Deserialize (TagBuffer i)
+{
+  m_segments = i.ReadU16 ();
+  m_segmentSize = i.ReadU16 ();
+  m_headerBytes = i.ReadU8 ();
+  m_spacing = i.ReadU64 ();
+  m_lastSpacing = i.ReadU64 ();
+}
+
+void
+CoalescedSegmentsTag::Print (std::ostream &os) const
+{
+  os << "segments=" << m_segments
+     << " segmentSize=" << m_segmentSize
+     << " headerBytes=" << (uint32_t) m_headerBytes
+     << " spacing=" << m_spacing << "ns"
+     << " lastSpacing=" << m_lastSpacing << "ns";
+}
+
+void
+CoalescedSegmentsTag::SetSegments (uint16_t segments)
+{
+  m_segments = segments;
+}
+
+uint16_t
+CoalescedSegmentsTag::GetSegments (void) const
+{
+  return m_segments;
+}
+
+void
+CoalescedSegmentsTag::SetSegmentSize (uint16_t size)
+{
+  m_segmentSize = size;
+}
+
+uint16_t
+CoalescedSegmentsTag::GetSegmentSize (void) const
+{
+  return m_segmentSize;
+}
+
+void
+CoalescedSegmentsTag::SetHeaderBytes (uint8_t bytes)
+{
+  m_headerBytes = bytes;
+}
+
+uint8_t
+CoalescedSegmentsTag::GetHeaderBytes (void) const
+{
+  return m_headerBytes;
+}
+
+uint16_t
+CoalescedSegmentsTag::GetLastSegmentSize (uint32_t payloadSize) const
+{
+  return payloadSize - (m_segments - 1) * m_segmentSize;
+}
+
+void
+CoalescedSegmentsTag::SetSpacing (Time spacing, Time lastSpacing)
+{
+  m_spacing = spacing.GetNanoSeconds ();
+  m_lastSpacing = lastSpacing.GetNanoSeconds ();
+}
+
+Time
+CoalescedSegmentsTag::GetSpacing (void) const
+{
+  return NanoSeconds (m_spacing);
+}
+
+Time
+CoalescedSegmentsTag::GetLastSpacing (void) const
+{
+  return NanoSeconds (m_lastSpacing);
+}
+
+
+//
+// RawFrame
+//
+
+RawFrame::RawFrame ()
+  : buffer (0),
+    size (0),
+    vlanId (0),
+    truncated (false),
+    arrival (0),
+    handover (0),
+    segments (1),
+    segmentSize (0),
+    headerBytes (0)
+{
+}
+
+//
+// FrameCoalescer
+//
+
+// offsets into an untagged Ethernet frame carrying IPv4 without options
+static const uint32_t IP_START = 14;
+static const uint32_t TCP_START = IP_START + 20;
+
+static uint16_t
+ReadU16 (const uint8_t *p)
+{
+  return (p[0] << 8) | p[1];
+}
+
+static uint32_t
+ReadU32 (const uint8_t *p)
+{
+  return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+static void
+WriteU16 (uint8_t *p, uint16_t value)
+{
+  p[0] = value >> 8;
+  p[1] = value & 0xff;
+}
+
+static uint16_t
+Ipv4HeaderChecksum (const uint8_t *ip)
+{
+  uint32_t sum = 0;
+  for (uint32_t i = 0; i < 20; i += 2)
+    {
+      sum += ReadU16 (ip + i);
+    }
+  while (sum >> 16)
+    {
+      sum = (sum & 0xffff) + (sum >> 16);
+    }
+  return ~sum & 0xffff;
+}
+
+// time to serialize a number of bytes at a bit rate, in ns
+static int64_t
+TxTimeNs (uint32_t bytes, uint64_t bitRate)
+{
+  return (int64_t) ((uint64_t) bytes * 8 * 1000000000 / bitRate);
+}
+
+FrameCoalescer::Limits::Limits ()
+  : bitRate (0),
+    maxSize (65000),
+    maxHold (1000000)
+{
+}
+
+bool
+FrameCoalescer::FlowKey::operator < (const FlowKey &other) const
+{
+  if (vlanId != other.vlanId)
+    {
+      return vlanId < other.vlanId;
+    }
+  if (source != other.source)
+    {
+      return source < other.source;
+    }
+  if (destination != other.destination)
+    {
+      return destination < other.destination;
+    }
+  if (sourcePort != other.sourcePort)
+    {
+      return sourcePort < other.sourcePort;
+    }
+  return destinationPort < other.destinationPort;
+}
+
+FrameCoalescer::FrameCoalescer ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+FrameCoalescer::~FrameCoalescer ()
+{
+  NS_LOG_FUNCTION (this);
+  for (std::map<FlowKey, Flow>::iterator i = m_flows.begin (); i != m_flows.end (); ++i)
+    {
+      free (i->second.frame.buffer);
+    }
+  m_flows.clear ();
+}
+
+bool
+FrameCoalescer::ParseTcp (const RawFrame &frame, uint32_t &tcpLength, uint32_t &payloadSize)
+{
+  if (frame.truncated || frame.size < TCP_START + 20)
+    {
+      return false;
+    }
+
+  const uint8_t *ip = frame.buffer + IP_START;
+  uint32_t totalLength = ReadU16 (ip + 2);
+  if (ReadU16 (frame.buffer + 12) != 0x0800
+      || ip[0] != 0x45                          // IPv4 without options
+      || (ReadU16 (ip + 6) & 0x3fff) != 0       // not a fragment
+      || ip[9] != TcpL4Protocol::PROT_NUMBER
+      || IP_START + totalLength > frame.size)
+    {
+      return false;
+    }
+
+  const uint8_t *tcp = frame.buffer + TCP_START;
+  tcpLength = (tcp[12] >> 4) * 4;
+  if (tcpLength < 20 || 20 + tcpLength > totalLength)
+    {
+      return false;
+    }
+  payloadSize = totalLength - 20 - tcpLength;
+  return true;
+}
+
+FrameCoalescer::FlowKey
+FrameCoalescer::GetFlowKey (const RawFrame &frame)
+{
+  const uint8_t *ip = frame.buffer + IP_START;
+  const uint8_t *tcp = frame.buffer + TCP_START;
+
+  FlowKey key;
+  key.vlanId = frame.vlanId;
+  key.source = ReadU32 (ip + 12);
+  key.destination = ReadU32 (ip + 16);
+  key.sourcePort = ReadU16 (tcp);
+  key.destinationPort = ReadU16 (tcp + 2);
+  return key;
+}
+
+void
+FrameCoalescer::Add (RawFrame frame, const Limits &limits, std::vector<RawFrame> &ready)
+{
+  //
+  // Every frame of the port takes its turn on the link, whether it is
+  // merged or not.  linkFreeAt is when the link would be done with the
+  // frames before this one.
+  //
+  int64_t linkFreeAt = 0;
+  if (limits.bitRate != 0)
+    {
+      int64_t &freeAt = m_linkFreeAt[frame.vlanId];
+      linkFreeAt = freeAt;
+      freeAt = std::max (freeAt, frame.arrival) + TxTimeNs (frame.size, limits.bitRate);
+    }
+
+  uint32_t tcpLength = 0;
+  uint32_t payloadSize = 0;
+  if (!ParseTcp (frame, tcpLength, payloadSize))
+    {
+      ready.push_back (frame);
+      return;
+    }
+
+  FlowKey key = GetFlowKey (frame);
+  uint32_t totalLength = 20 + tcpLength + payloadSize;
+
+  // only plain data segments are merged; SYN, FIN, RST, URG, ECE and CWR
+  // always go up on their own
+  uint8_t flags = frame.buffer[TCP_START + 13];
+  bool mergeable = limits.bitRate != 0
+    && frame.arrival != 0
+    && payloadSize > 0
+    && (flags & TcpHeader::ACK)
+    && (flags & ~(TcpHeader::ACK | TcpHeader::PSH)) == 0;
+
+  std::map<FlowKey, Flow>::iterator iter = m_flows.find (key);
+  if (iter != m_flows.end ())
+    {
+      Flow &flow = iter->second;
+      if (mergeable && CanMerge (flow, frame, linkFreeAt, tcpLength, payloadSize))
+        {
+          std::memcpy (flow.frame.buffer + flow.frame.size, frame.buffer + TCP_START + tcpLength, payloadSize);
+          flow.frame.size += payloadSize;
+          flow.frame.segments++;
+          flow.frame.readWaits.insert (flow.frame.readWaits.end (), frame.readWaits.begin (), frame.readWaits.end ());
+          free (frame.buffer);
+
+          flow.nextSequence += payloadSize;
+          flow.nextIdentification++;
+          flow.end = m_linkFreeAt[frame.vlanId];
+          flow.deadline = std::min (flow.end, flow.frame.arrival + flow.limits.maxHold);
+          flow.push = (flags & TcpHeader::PSH) != 0;
+
+          // a short or pushed segment ends the run, as does a full packet
+          if (flow.push
+              || payloadSize < flow.frame.segmentSize
+              || flow.frame.size - IP_START + flow.frame.segmentSize > flow.limits.maxSize)
+            {
+              Finish (flow, ready);
+              m_flows.erase (iter);
+            }
+          return;
+        }
+      Finish (flow, ready);
+      m_flows.erase (iter);
+    }
+
+  // a segment that could not even take one more like it is not worth holding
+  if (!mergeable
+      || (flags & TcpHeader::PSH)
+      || totalLength + payloadSize > limits.maxSize)
+    {
+      ready.push_back (frame);
+      return;
+    }
+
+  Flow &flow = m_flows[key];
+  flow.frame = frame;
+  flow.frame.size = IP_START + totalLength;       // drop any Ethernet padding
+  flow.frame.buffer = (uint8_t *) realloc (frame.buffer, IP_START + limits.maxSize);
+  NS_ABORT_MSG_IF (flow.frame.buffer == 0, "realloc() failed");
+  flow.frame.segmentSize = payloadSize;
+  flow.frame.headerBytes = 20 + tcpLength;
+  flow.limits = limits;
+  flow.tcpLength = tcpLength;
+  flow.nextSequence = ReadU32 (flow.frame.buffer + TCP_START + 4) + payloadSize;
+  flow.nextIdentification = ReadU16 (flow.frame.buffer + IP_START + 4) + 1;
+  flow.end = m_linkFreeAt[frame.vlanId];
+  flow.deadline = std::min (flow.end, frame.arrival + limits.maxHold);
+  flow.push = false;
+}
+
+bool
+FrameCoalescer::CanMerge (const Flow &flow, const RawFrame &frame, int64_t linkFreeAt,
+                          uint32_t tcpLength, uint32_t payloadSize) const
+{
+  const uint8_t *held = flow.frame.buffer;
+  const uint8_t *buffer = frame.buffer;
+
+  // the segment must directly follow the last merged one on the link
+  if (frame.arrival > flow.deadline
+      || linkFreeAt != flow.end
+      || tcpLength != flow.tcpLength
+      || payloadSize > flow.frame.segmentSize
+      || flow.frame.size - IP_START + payloadSize > flow.limits.maxSize
+      || ReadU32 (buffer + TCP_START + 4) != flow.nextSequence
+      || ReadU16 (buffer + IP_START + 4) != flow.nextIdentification)
+    {
+      return false;
+    }
+
+  // Ethernet header, and IPv4 TOS, flags and TTL
+  if (std::memcmp (held, buffer, IP_START) != 0
+      || held[IP_START + 1] != buffer[IP_START + 1]
+      || held[IP_START + 6] != buffer[IP_START + 6]
+      || held[IP_START + 8] != buffer[IP_START + 8])
+    {
+      return false;
+    }
+
+  // everything in the TCP header but the sequence number, checksum and PSH,
+  // options included
+  const uint8_t *a = held + TCP_START;
+  const uint8_t *b = buffer + TCP_START;
+  return std::memcmp (a + 8, b + 8, 5) == 0
+         && (a[13] & ~TcpHeader::PSH) == (b[13] & ~TcpHeader::PSH)
+         && std::memcmp (a + 14, b + 14, 2) == 0
+         && std::memcmp (a + 18, b + 18, tcpLength - 18) == 0;
+}
+
+void
+FrameCoalescer::Finish (Flow &flow, std::vector<RawFrame> &ready)
+{
+  RawFrame &frame = flow.frame;
+  if (frame.segments > 1)
+    {
+      uint8_t *ip = frame.buffer + IP_START;
+      WriteU16 (ip + 2, frame.size - IP_START);
+      WriteU16 (ip + 10, 0);
+      WriteU16 (ip + 10, Ipv4HeaderChecksum (ip));
+      if (flow.push)
+        {
+          frame.buffer[TCP_START + 13] |= TcpHeader::PSH;
+        }
+      // The TCP checksum still covers the first segment only; the
+      // SegmentSplitter gives every segment its own again.
+      NS_LOG_LOGIC ("merged " << frame.segments << " segments into " << frame.size << " bytes");
+    }
+  ready.push_back (frame);
+}
+
+int64_t
+FrameCoalescer::Expire (int64_t now, std::vector<RawFrame> &ready)
+{
+  int64_t next = -1;
+  std::map<FlowKey, Flow>::iterator i = m_flows.begin ();
+  while (i != m_flows.end ())
+    {
+      if (i->second.deadline <= now)
+        {
+          Finish (i->second, ready);
+          m_flows.erase (i++);
+        }
+      else
+        {
+          if (next == -1 || i->second.deadline < next)
+            {
+              next = i->second.deadline;
+            }
+          ++i;
+        }
+    }
+  return next;
+}
+
+void
+FrameCoalescer::Flush (std::vector<RawFrame> &ready)
+{
+  for (std::map<FlowKey, Flow>::iterator i = m_flows.begin (); i != m_flows.end (); ++i)
+    {
+      Finish (i->second, ready);
+    }
+  m_flows.clear ();
+}
+
+//
+// SegmentSplitter
+//
+
+void
+SegmentSplitter::Split (Ptr<const Packet> packet, std::vector<Ptr<Packet> > &segments, std::vector<Time> &offsets)
+{
+  NS_LOG_FUNCTION (packet);
+
+  Ptr<Packet> p = packet->Copy ();
+  CoalescedSegmentsTag tag;
+  NS_ABORT_MSG_UNLESS (p->RemovePacketTag (tag), "SegmentSplitter::Split(): packet is not coalesced");
+
+  Ipv4Header ipHeader;
+  p->RemoveHeader (ipHeader);
+  TcpHeader tcpHeader;
+  p->RemoveHeader (tcpHeader);
+
+  uint32_t payloadSize = p->GetSize ();
+  uint16_t segmentCount = tag.GetSegments ();
+  uint16_t segmentSize = tag.GetSegmentSize ();
+  SequenceNumber32 sequence = tcpHeader.GetSequenceNumber ();
+  uint16_t identification = ipHeader.GetIdentification ();
+  uint8_t flags = tcpHeader.GetFlags ();
+
+  NS_LOG_LOGIC ("splitting " << payloadSize << " bytes into " << segmentCount << " segments");
+
+  // The first segment is due at once, every later one a segment's spacing
+  // after the one before it.
+  Time offset = Seconds (0);
+  uint32_t start = 0;
+  for (uint16_t i = 0; i < segmentCount; i++)
+    {
+      bool last = i + 1 == segmentCount;
+      uint32_t size = last ? payloadSize - start : segmentSize;
+      Ptr<Packet> segment = p->CreateFragment (start, size);
+
+      TcpHeader segmentTcpHeader = tcpHeader;
+      segmentTcpHeader.SetSequenceNumber (sequence + start);
+      segmentTcpHeader.SetFlags (last ? flags : flags & ~TcpHeader::PSH);
+      if (Node::ChecksumEnabled ())
+        {
+          segmentTcpHeader.EnableChecksums ();
+          segmentTcpHeader.InitializeChecksum (ipHeader.GetSource (), ipHeader.GetDestination (),
+                                               TcpL4Protocol::PROT_NUMBER);
+        }
+      segment->AddHeader (segmentTcpHeader);
+
+      Ipv4Header segmentIpHeader = ipHeader;
+      segmentIpHeader.SetIdentification (identification + i);
+      segmentIpHeader.SetPayloadSize (segment->GetSize ());
+      if (Node::ChecksumEnabled ())
+        {
+          segmentIpHeader.EnableChecksum ();
+        }
+      segment->AddHeader (segmentIpHeader);
+
+      if (i > 0)
+        {
+          offset += last ? tag.GetLastSpacing () : tag.GetSpacing ();
+        }
+      segments.push_back (segment);
+      offsets.push_back (offset);
+      start += size;
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,213 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SEGMENT_OFFLOAD_H
+#define SEGMENT_OFFLOAD_H
+
+#include <map>
+#include <vector>
+
+#include "ns3/tag.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+
+namespace ns3 {
+
+//
+// GRO/GSO-style handling of bulk TCP on the emulation path.
+//
+// A FrameCoalescer runs in the emu reader thread, before frames become
+// simulator events.  It merges consecutive in-order TCP segments of one flow
+// into one large frame, the way Linux GRO does: only segments whose
+// Ethernet, IP and TCP headers are identical apart from the IP
+// identification, sequence number, checksums and PSH flag are merged.
+//
+// The coalescer follows the link a port's frames go on to, at its rate, as
+// if they were sent one by one.  A segment is only merged if it arrived
+// while that link would still have been busy with the segment before it,
+// with no other frame of the port in between.  Sending the merged segments
+// back to back therefore gives each the start it would have had on its
+// own, never one before it really arrived.  Under a standing queue that
+// holds for long runs; a link that goes idle between segments ends the
+// run.  The large packet then enters the simulator, crosses IPv4
+// forwarding and the channel model as a single event.
+//
+// SegmentSplitter cuts it back into the original segments, with the
+// original headers, where it leaves on an emu device.  The device sends
+// them at the spacing the channel reported, so the frames reach the wire
+// with the same timing they would have had one by one.
+//
+
+/**
+ * Describes the segments carried by a coalesced packet.
+ *
+ * Set when a coalesced frame enters the simulator; channels that understand
+ * it use it to charge the per-frame header overhead of the original
+ * segments and to tell the SegmentSplitter how far apart the segments
+ * would have arrived.
+ */
+class CoalescedSegmentsTag : public Tag
+{
+public:
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  CoalescedSegmentsTag ();
+
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  virtual void Print (std::ostream &os) const;
+
+  /** Number of original segments. */
+  void SetSegments (uint16_t segments);
+  uint16_t GetSegments (void) const;
+
+  /** TCP payload of each segment but the last one. */
+  void SetSegmentSize (uint16_t size);
+  uint16_t GetSegmentSize (void) const;
+
+  /** IPv4 plus TCP header bytes every segment carries on its own. */
+  void SetHeaderBytes (uint8_t bytes);
+  uint8_t GetHeaderBytes (void) const;
+
+  /** Payload of the last segment. */
+  uint16_t GetLastSegmentSize (uint32_t payloadSize) const;
+
+  /** Arrival spacing of full segments, and of the last one, at the exit. */
+  void SetSpacing (Time spacing, Time lastSpacing);
+  Time GetSpacing (void) const;
+  Time GetLastSpacing (void) const;
+
+private:
+  uint16_t m_segments;
+  uint16_t m_segmentSize;
+  uint8_t m_headerBytes;
+  int64_t m_spacing;          // ns
+  int64_t m_lastSpacing;      // ns
+};
+
+/**
+ * An Ethernet frame read off a host interface, without its 802.1Q tag, or
+ * several TCP segments merged into one.
+ */
+struct RawFrame
+{
+  RawFrame ();
+
+  uint8_t *buffer;            // malloc()ed; whoever holds the frame frees it
+  uint32_t size;
+  uint16_t vlanId;
+  bool truncated;             // did not fit the read buffer
+  int64_t arrival;            // kernel receive time of the (first) segment, ns since the epoch, 0 if unknown
+  int64_t handover;           // wall clock time the frame was handed to the simulator, ns since the epoch
+  uint16_t segments;          // 1 unless segments were merged
+  uint16_t segmentSize;       // TCP payload of each merged segment but the last
+  uint8_t headerBytes;        // IPv4 plus TCP header bytes of each merged segment
+  std::vector<int64_t> readWaits;   // kernel receive to socket read of every frame in this one, ns
+};
+
+/**
+ * Merges consecutive TCP segments of raw Ethernet frames.  Not thread safe;
+ * meant for the one thread that reads the frames.
+ */
+class FrameCoalescer
+{
+public:
+  /** How far frames of one port may be merged. */
+  struct Limits
+  {
+    Limits ();
+
+    uint64_t bitRate;         // rate of the link the frames go on to; 0 turns merging off
+    uint32_t maxSize;         // largest IPv4 packet to build
+    int64_t maxHold;          // longest time after the first segment arrived to wait for more, ns;
+                              // merged packets are not late as long as it is at most the
+                              // link's propagation delay plus one frame time
+  };
+
+  FrameCoalescer ();
+  ~FrameCoalescer ();
+
+  /**
+   * Offer a frame.  Frames that are done with, merged or not, are appended
+   * to ready in the order they were done with.
+   */
+  void Add (RawFrame frame, const Limits &limits, std::vector<RawFrame> &ready);
+
+  /**
+   * Hand over every flow whose next segment can no longer arrive in time
+   * for it, as of now (ns since the epoch).
+   *
+   * \returns the time the next held flow runs out, or -1 if none is held
+   */
+  int64_t Expire (int64_t now, std::vector<RawFrame> &ready);
+
+  /** Hand over every held flow. */
+  void Flush (std::vector<RawFrame> &ready);
+
+private:
+  struct FlowKey
+  {
+    uint16_t vlanId;
+    uint32_t source;
+    uint32_t destination;
+    uint16_t sourcePort;
+    uint16_t destinationPort;
+
+    bool operator < (const FlowKey &other) const;
+  };
+
+  struct Flow
+  {
+    RawFrame frame;               // first segment, with the payload merged so far
+    Limits limits;
+    uint32_t tcpLength;
+    uint32_t nextSequence;
+    uint16_t nextIdentification;
+    int64_t end;                  // when the link would be done with the last merged segment
+    int64_t deadline;             // latest arrival of a segment that can still merge
+    bool push;
+  };
+
+  static bool ParseTcp (const RawFrame &frame, uint32_t &tcpLength, uint32_t &payloadSize);
+  static FlowKey GetFlowKey (const RawFrame &frame);
+  bool CanMerge (const Flow &flow, const RawFrame &frame, int64_t linkFreeAt,
+                 uint32_t tcpLength, uint32_t payloadSize) const;
+  void Finish (Flow &flow, std::vector<RawFrame> &ready);
+
+  std::map<FlowKey, Flow> m_flows;
+  std::map<uint16_t, int64_t> m_linkFreeAt;   // per VLAN: when the link is done with the frames so far
+};
+
+/**
+ * Cuts coalesced packets back into their segments.
+ */
+class SegmentSplitter
+{
+public:
+  /**
+   * \param packet an IPv4 packet carrying a CoalescedSegmentsTag
+   * \param segments the segments, as IPv4 packets with their original
+   *        headers, in order
+   * \param offsets when each segment is due, relative to the first
+   */
+  static void Split (Ptr<const Packet> packet, std::vector<Ptr<Packet> > &segments, std::vector<Time> &offsets);
+};
+
+} // namespace ns3
+
+#endif /* SEGMENT_OFFLOAD_H */
@@ -0,0 +1,812 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "switched-ethernet.h"
+#include "segment-offload.h"
+#include "ingest-wait-tag.h"
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/pointer.h"
+#include "ns3/uinteger.h"
+#include "ns3/ethernet-header.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("SwitchedEthernet");
+
+NS_OBJECT_ENSURE_REGISTERED (SwitchedEthernetNetDevice);
+NS_OBJECT_ENSURE_REGISTERED (SwitchedEthernetChannel);
+
+//
+// SwitchedEthernetNetDevice
+//
+
+TypeId
+SwitchedEthernetNetDevice::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::SwitchedEthernetNetDevice")
+    .SetParent<NetDevice> ()
+    .SetGroupName ("SwitchedEthernet")
+    .AddConstructor<SwitchedEthernetNetDevice> ()
+    .AddAttribute ("Address",
+                   "The MAC address of this device.",
+                   Mac48AddressValue (Mac48Address ("ff:ff:ff:ff:ff:ff")),
+                   MakeMac48AddressAccessor (&SwitchedEthernetNetDevice::m_address),
+                   MakeMac48AddressChecker ())
+    .AddAttribute ("Mtu", "The MAC-level Maximum Transmission Unit",
+                   UintegerValue (1500),
+                   MakeUintegerAccessor (&SwitchedEthernetNetDevice::SetMtu,
+                                         &SwitchedEthernetNetDevice::GetMtu),
+                   MakeUintegerChecker<uint16_t> ())
+    .AddAttribute ("TxQueue",
+                   "The queue holding frames waiting for the node->switch link.",
+                   PointerValue (),
+                   MakePointerAccessor (&SwitchedEthernetNetDevice::m_queue),
+                   MakePointerChecker<Queue<Packet> > ())
+    .AddTraceSource ("MacTx",
+                     "A packet has been accepted by the device for transmission",
+                     MakeTraceSourceAccessor (&SwitchedEthernetNetDevice::m_macTxTrace),
+                     "ns3::Packet::TracedCallback")
+    .AddTraceSource ("MacTxDrop",
+                     "A packet has been dropped by the device before transmission",
+                     MakeTraceSourceAccessor (&SwitchedEthernetNetDevice::m_macTxDropTrace),
+                     "ns3::Packet::TracedCallback")
+    .AddTraceSource ("MacRx",
+                     "A packet has been received by the device and is being forwarded up",
+                     MakeTraceSourceAccessor (&SwitchedEthernetNetDevice::m_macRxTrace),
+                     "ns3::Packet::TracedCallback")
+    .AddTraceSource ("Sniffer",
+                     "Trace source simulating a non-promiscuous packet sniffer attached to the device",
+                     MakeTraceSourceAccessor (&SwitchedEthernetNetDevice::m_snifferTrace),
+                     "ns3::Packet::TracedCallback")
+    .AddTraceSource ("PromiscSniffer",
+                     "Trace source simulating a promiscuous packet sniffer attached to the device",
+                     MakeTraceSourceAccessor (&SwitchedEthernetNetDevice::m_promiscSnifferTrace),
+                     "ns3::Packet::TracedCallback")
+  ;
+  return tid;
+}
+
+SwitchedEthernetNetDevice::SwitchedEthernetNetDevice ()
+  : m_node (0),
+    m_channel (0),
+    m_queue (0),
+    m_queueInterface (0),
+    m_ifIndex (0),
+    m_port (0),
+    m_mtu (1500),
+    m_linkUp (false),
+    m_txBusy (false)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+SwitchedEthernetNetDevice::~SwitchedEthernetNetDevice ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+SwitchedEthernetNetDevice::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_node = 0;
+  m_channel = 0;
+  m_queue = 0;
+  m_queueInterface = 0;
+  m_rxCallback = MakeNullCallback<bool, Ptr<NetDevice>, Ptr<const Packet>, uint16_t, const Address &> ();
+  m_promiscRxCallback = MakeNullCallback<bool, Ptr<NetDevice>, Ptr<const Packet>, uint16_t, const Address &, const Address &, enum PacketType> ();
+  NetDevice::DoDispose ();
+}
+
+void
+SwitchedEthernetNetDevice::NotifyNewAggregate (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_queueInterface == 0)
+    {
+      m_queueInterface = GetObject<NetDeviceQueueInterface> ();
+    }
+  NetDevice::NotifyNewAggregate ();
+}
+
+void
+SwitchedEthernetNetDevice::Attach (Ptr<SwitchedEthernetChannel> channel, Ptr<Queue<Packet> > egressQueue)
+{
+  NS_LOG_FUNCTION (this << channel << egressQueue);
+  m_channel = channel;
+  m_port = m_channel->Attach (this, egressQueue);
+  m_linkUp = true;
+  m_linkChangeCallbacks ();
+}
+
+void
+SwitchedEthernetNetDevice::SetQueue (Ptr<Queue<Packet> > queue)
+{
+  NS_LOG_FUNCTION (this << queue);
+  m_queue = queue;
+}
+
+Ptr<Queue<Packet> >
+SwitchedEthernetNetDevice::GetQueue (void) const
+{
+  return m_queue;
+}
+
+bool
+SwitchedEthernetNetDevice::Send (Ptr<Packet> packet, const Address& dest, uint16_t protocolNumber)
+{
+  NS_LOG_FUNCTION (this << packet << dest << protocolNumber);
+  return SendFrom (packet, m_address, dest, protocolNumber);
+}
+
+bool
+SwitchedEthernetNetDevice::SendFrom (Ptr<Packet> packet, const Address& source, const Address& dest, uint16_t protocolNumber)
+{
+  NS_LOG_FUNCTION (this << packet << source << dest << protocolNumber);
+  NS_ASSERT_MSG (m_channel != 0, "SwitchedEthernetNetDevice::SendFrom(): device is not attached to a segment");
+
+  if (!m_linkUp)
+    {
+      m_macTxDropTrace (packet);
+      return false;
+    }
+
+  EthernetHeader header (false);
+  header.SetSource (Mac48Address::ConvertFrom (source));
+  header.SetDestination (Mac48Address::ConvertFrom (dest));
+  header.SetLengthType (protocolNumber);
+  packet->AddHeader (header);
+
+  Ptr<NetDeviceQueue> txq;
+  if (m_queueInterface != 0)
+    {
+      txq = m_queueInterface->GetTxQueue (0);
+    }
+
+  m_macTxTrace (packet);
+
+  if (!m_queue->Enqueue (packet))
+    {
+      m_macTxDropTrace (packet);
+      return false;
+    }
+
+  if (txq != 0)
+    {
+      txq->NotifyQueuedBytes (packet->GetSize ());
+    }
+
+  if (!m_txBusy)
+    {
+      TransmitStart ();
+    }
+
+  // hold the queue disc back until a full frame fits again
+  if (txq != 0 && IsQueueFull ())
+    {
+      txq->Stop ();
+    }
+  return true;
+}
+
+bool
+SwitchedEthernetNetDevice::IsQueueFull (void) const
+{
+  QueueSize maxSize = m_queue->GetMaxSize ();
+  if (maxSize.GetUnit () == QueueSizeUnit::PACKETS)
+    {
+      return m_queue->GetNPackets () >= maxSize.GetValue ();
+    }
+  return m_queue->GetNBytes () + m_mtu + EthernetHeader (false).GetSerializedSize () > maxSize.GetValue ();
+}
+
+void
+SwitchedEthernetNetDevice::TransmitStart (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  if (m_queue->IsEmpty ())
+    {
+      return;
+    }
+
+  Ptr<Packet> packet = m_queue->Dequeue ();
+  m_txBusy = true;
+
+  m_snifferTrace (packet);
+  m_promiscSnifferTrace (packet);
+
+  Time txTime = m_channel->TransmitStart (packet, m_port);
+  Simulator::Schedule (txTime, &SwitchedEthernetNetDevice::TransmitComplete, this);
+
+  //
+  // Last, since waking the queue disc sends the next packet right away;
+  // with m_txBusy set it only gets queued.
+  //
+  if (m_queueInterface != 0)
+    {
+      Ptr<NetDeviceQueue> txq = m_queueInterface->GetTxQueue (0);
+      txq->NotifyTransmittedBytes (packet->GetSize ());
+      if (txq->IsStopped () && !IsQueueFull ())
+        {
+          txq->Wake ();
+        }
+    }
+}
+
+void
+SwitchedEthernetNetDevice::TransmitComplete (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_txBusy = false;
+  TransmitStart ();
+}
+
+void
+SwitchedEthernetNetDevice::Receive (Ptr<Packet> packet)
+{
+  NS_LOG_FUNCTION (this << packet);
+
+  Ptr<Packet> originalPacket = packet->Copy ();
+
+  EthernetHeader header (false);
+  packet->RemoveHeader (header);
+
+  Mac48Address from = header.GetSource ();
+  Mac48Address to = header.GetDestination ();
+  uint16_t protocol = header.GetLengthType ();
+
+  NetDevice::PacketType packetType;
+  if (to == m_address)
+    {
+      packetType = NetDevice::PACKET_HOST;
+    }
+  else if (to.IsBroadcast ())
+    {
+      packetType = NetDevice::PACKET_BROADCAST;
+    }
+  else if (to.IsGroup ())
+    {
+      packetType = NetDevice::PACKET_MULTICAST;
+    }
+  else
+    {
+      packetType = NetDevice::PACKET_OTHERHOST;
+    }
+
+  m_promiscSnifferTrace (originalPacket);
+  if (!m_promiscRxCallback.IsNull ())
+    {
+      m_promiscRxCallback (this, packet, protocol, from, to, packetType);
+    }
+
+  if (packetType != NetDevice::PACKET_OTHERHOST)
+    {
+      m_snifferTrace (originalPacket);
+      m_macRxTrace (originalPacket);
+      m_rxCallback (this, packet, protocol, from);
+    }
+}
+
+void
+SwitchedEthernetNetDevice::SetIfIndex (const uint32_t index)
+{
+  m_ifIndex = index;
+}
+
+uint32_t
+SwitchedEthernetNetDevice::GetIfIndex (void) const
+{
+  return m_ifIndex;
+}
+
+Ptr<Channel>
+SwitchedEthernetNetDevice::GetChannel (void) const
+{
+  return m_channel;
+}
+
+void
+SwitchedEthernetNetDevice::SetAddress (Address address)
+{
+  m_address = Mac48Address::ConvertFrom (address);
+}
+
+Address
+SwitchedEthernetNetDevice::GetAddress (void) const
+{
+  return m_address;
+}
+
+bool
+SwitchedEthernetNetDevice::SetMtu (const uint16_t mtu)
+{
+  m_mtu = mtu;
+  return true;
+}
+
+uint16_t
+SwitchedEthernetNetDevice::GetMtu (void) const
+{
+  return m_mtu;
+}
+
+bool
+SwitchedEthernetNetDevice::IsLinkUp (void) const
+{
+  return m_linkUp;
+}
+
+void
+SwitchedEthernetNetDevice::AddLinkChangeCallback (Callback<void> callback)
+{
+  m_linkChangeCallbacks.ConnectWithoutContext (callback);
+}
+
+bool
+SwitchedEthernetNetDevice::IsBroadcast (void) const
+{
+  return true;
+}
+
+Address
+SwitchedEthernetNetDevice::GetBroadcast (void) const
+{
+  return Mac48Address::GetBroadcast ();
+}
+
+bool
+SwitchedEthernetNetDevice::IsMulticast (void) const
+{
+  return true;
+}
+
+Address
+SwitchedEthernetNetDevice::GetMulticast (Ipv4Address multicastGroup) const
+{
+  return Mac48Address::GetMulticast (multicastGroup);
+}
+
+Address
+SwitchedEthernetNetDevice::GetMulticast (Ipv6Address addr) const
+{
+  return Mac48Address::GetMulticast (addr);
+}
+
+bool
+SwitchedEthernetNetDevice::IsBridge (void) const
+{
+  return false;
+}
+
+bool
+SwitchedEthernetNetDevice::IsPointToPoint (void) const
+{
+  return false;
+}
+
+Ptr<Node>
+SwitchedEthernetNetDevice::GetNode (void) const
+{
+  return m_node;
+}
+
+void
+SwitchedEthernetNetDevice::SetNode (Ptr<Node> node)
+{
+  m_node = node;
+}
+
+bool
+SwitchedEthernetNetDevice::NeedsArp (void) const
+{
+  return true;
+}
+
+void
+SwitchedEthernetNetDevice::SetReceiveCallback (NetDevice::ReceiveCallback cb)
+{
+  m_rxCallback = cb;
+}
+
+void
+SwitchedEthernetNetDevice::SetPromiscReceiveCallback (NetDevice::PromiscReceiveCallback cb)
+{
+  m_promiscRxCallback = cb;
+}
+
+bool
+SwitchedEthernetNetDevice::SupportsSendFrom (void) const
+{
+  return true;
+}
+
+//
+// SwitchedEthernetChannel
+//
+
+TypeId
+SwitchedEthernetChannel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::SwitchedEthernetChannel")
+    .SetParent<Channel> ()
+    .SetGroupName ("SwitchedEthernet")
+    .AddConstructor<SwitchedEthernetChannel> ()
+    .AddAttribute ("DataRate",
+                   "The rate of each direction of every port link.",
+                   DataRateValue (DataRate (0xffffffff)),
+                   MakeDataRateAccessor (&SwitchedEthernetChannel::m_bps),
+                   MakeDataRateChecker ())
+    .AddAttribute ("Delay",
+                   "The propagation delay between any two ports.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&SwitchedEthernetChannel::m_delay),
+                   MakeTimeChecker ())
+    .AddAttribute ("ExpirationTime",
+                   "Time it takes for a learned MAC address to expire.",
+                   TimeValue (Seconds (300)),
+                   MakeTimeAccessor (&SwitchedEthernetChannel::m_expirationTime),
+                   MakeTimeChecker ())
+    .AddTraceSource ("Drop",
+                     "A frame has been dropped at a full switch egress queue",
+                     MakeTraceSourceAccessor (&SwitchedEthernetChannel::m_dropTrace),
+                     "ns3::Packet::TracedCallback")
+  ;
+  return tid;
+}
+
+SwitchedEthernetChannel::SwitchedEthernetChannel ()
+  : Channel ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+SwitchedEthernetChannel::~SwitchedEthernetChannel ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+SwitchedEthernetChannel::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_ports.clear ();
+  m_learnedAddresses.clear ();
+  Channel::DoDispose ();
+}
+
+uint32_t
+SwitchedEthernetChannel::Attach (Ptr<SwitchedEthernetNetDevice> device, Ptr<Queue<Packet> > egressQueue)
+{
+  NS_LOG_FUNCTION (this << device << egressQueue);
+
+  Port port;
+  port.device = device;
+  port.egress = egressQueue;
+  port.busy = false;
+  port.txFreeAt = Seconds (0);
+  m_ports.push_back (port);
+
+  return m_ports.size () - 1;
+}
+
+Time
+SwitchedEthernetChannel::TransmitStart (Ptr<const Packet> packet, uint32_t port)
+{
+  NS_LOG_FUNCTION (this << packet << port);
+  NS_ASSERT (port < m_ports.size ());
+
+  Ptr<Packet> copy = packet->Copy ();
+  Time firstTxTime;
+  Time txTime = CalculateTxTime (copy, firstTxTime);
+
+  //
+  // Time the frame already lost before it got here, waiting in the emu
+  // socket buffer or held for coalescing, moves its arrival back.  The link
+  // starts sending it when it arrived or when the frame before it was done,
+  // whichever is later, so a frame that queued behind others is not
+  // credited twice.
+  //
+  Time arrival = Simulator::Now ();
+
+  IngestWaitTag waitTag;
+  if (copy->RemovePacketTag (waitTag))
+    {
+      arrival -= waitTag.GetWait ();
+    }
+
+  Port &p = m_ports[port];
+  Time start = Max (p.txFreeAt, arrival);
+  p.txFreeAt = start + txTime;
+
+  //
+  // Store and forward: the switch looks at the frame once its last bit has
+  // arrived, i.e. one serialization time plus the propagation delay after
+  // the link started sending it.  For coalesced segments that is the time
+  // the first segment would have been complete.  Successive frames start
+  // no earlier than the end of the one before, so a port never forwards
+  // out of order; a frame whose forwarding time has already passed goes
+  // now.
+  //
+  Time forward = Max (start + firstTxTime + m_delay - Simulator::Now (), Seconds (0));
+  Simulator::Schedule (forward, &SwitchedEthernetChannel::Forward, this, copy, port);
+
+  return Max (p.txFreeAt - Simulator::Now (), Seconds (0));
+}
+
+Time
+SwitchedEthernetChannel::CalculateTxTime (Ptr<const Packet> packet, Time &firstTxTime) const
+{
+  CoalescedSegmentsTag tag;
+  if (!packet->PeekPacketTag (tag) || tag.GetSegments () < 2)
+    {
+      firstTxTime = m_bps.CalculateBytesTxTime (packet->GetSize ());
+      return firstTxTime;
+    }
+
+  //
+  // Charge every Ethernet, IPv4 and TCP header the segments would have
+  // carried on their own, so the link is busy exactly as long as it would
+  // have been for the original frames.
+  //
+  uint32_t overhead = EthernetHeader (false).GetSerializedSize () + tag.GetHeaderBytes ();
+  firstTxTime = m_bps.CalculateBytesTxTime (overhead + tag.GetSegmentSize ());
+  return m_bps.CalculateBytesTxTime (packet->GetSize () + (tag.GetSegments () - 1) * overhead);
+}
+
+void
+SwitchedEthernetChannel::Forward (Ptr<Packet> packet, uint32_t ingress)
+{
+  NS_LOG_FUNCTION (this << packet << ingress);
+
+  EthernetHeader header (false);
+  packet->PeekHeader (header);
+
+  Learn (header.GetSource (), ingress);
+
+  Mac48Address destination = header.GetDestination ();
+  uint32_t egress;
+  if (!destination.IsGroup () && Lookup (destination, egress))
+    {
+      // never reflect a frame back out of the port it came in on
+      if (egress != ingress)
+        {
+          Enqueue (egress, packet);
+        }
+      return;
+    }
+
+  for (uint32_t i = 0; i < m_ports.size (); ++i)
+    {
+      if (i != ingress)
+        {
+          Enqueue (i, packet->Copy ());
+        }
+    }
+}
+
+void
+SwitchedEthernetChannel::Learn (Mac48Address source, uint32_t port)
+{
+  NS_LOG_FUNCTION (this << source << port);
+
+  if (source.IsGroup ())
+    {
+      return;
+    }
+
+  LearnedState &state = m_learnedAddresses[source];
+  state.port = port;
+  state.expirationTime = Simulator::Now () + m_expirationTime;
+}
+
+bool
+SwitchedEthernetChannel::Lookup (Mac48Address destination, uint32_t &port)
+{
+  NS_LOG_FUNCTION (this << destination);
+
+  std::map<Mac48Address, LearnedState>::iterator iter = m_learnedAddresses.find (destination);
+  if (iter == m_learnedAddresses.end ())
+    {
+      return false;
+    }
+  if (iter->second.expirationTime <= Simulator::Now ())
+    {
+      m_learnedAddresses.erase (iter);
+      return false;
+    }
+  port = iter->second.port;
+  return true;
+}
+
+void
+SwitchedEthernetChannel::Enqueue (uint32_t port, Ptr<Packet> packet)
+{
+  NS_LOG_FUNCTION (this << port << packet);
+
+  if (!m_ports[port].egress->Enqueue (packet))
+    {
+      m_dropTrace (packet);
+      return;
+    }
+
+  if (!m_ports[port].busy)
+    {
+      EgressStart (port);
+    }
+}
+
+void
+SwitchedEthernetChannel::EgressStart (uint32_t port)
+{
+  NS_LOG_FUNCTION (this << port);
+
+  Port &p = m_ports[port];
+  if (p.egress->IsEmpty ())
+    {
+      return;
+    }
+
+  Ptr<Packet> packet = p.egress->Dequeue ();
+  p.busy = true;
+
+  Time firstTxTime;
+  Time txTime = CalculateTxTime (packet, firstTxTime);
+
+  //
+  // Coalesced segments are handed over when the first of them would have
+  // arrived; the spacing tells the splitter when the others are due.
+  //
+  CoalescedSegmentsTag tag;
+  if (packet->RemovePacketTag (tag))
+    {
+      uint32_t overhead = EthernetHeader (false).GetSerializedSize () + tag.GetHeaderBytes ();
+      uint32_t payloadSize = packet->GetSize () - overhead;
+      tag.SetSpacing (firstTxTime,
+                      m_bps.CalculateBytesTxTime (overhead + tag.GetLastSegmentSize (payloadSize)));
+      packet->AddPacketTag (tag);
+    }
+
+  Simulator::Schedule (txTime, &SwitchedEthernetChannel::EgressComplete, this, port);
+  Simulator::ScheduleWithContext (p.device->GetNode ()->GetId (), firstTxTime,
+                                  &SwitchedEthernetNetDevice::Receive, p.device, packet);
+}
+
+void
+SwitchedEthernetChannel::EgressComplete (uint32_t port)
+{
+  NS_LOG_FUNCTION (this << port);
+  m_ports[port].busy = false;
+  EgressStart (port);
+}
+
+std::size_t
+SwitchedEthernetChannel::GetNDevices (void) const
+{
+  return m_ports.size ();
+}
+
+Ptr<NetDevice>
+SwitchedEthernetChannel::GetDevice (std::size_t i) const
+{
+  NS_ASSERT (i < m_ports.size ());
+  return m_ports[i].device;
+}
+
+//
+// SwitchedEthernetHelper
+//
+
+SwitchedEthernetHelper::SwitchedEthernetHelper ()
+{
+  m_queueFactory.SetTypeId ("ns3::DropTailQueue<Packet>");
+  m_deviceFactory.SetTypeId ("ns3::SwitchedEthernetNetDevice");
+  m_channelFactory.SetTypeId ("ns3::SwitchedEthernetChannel");
+}
+
+void
+SwitchedEthernetHelper::SetQueue (std::string type,
+                                  std::string n1, const AttributeValue &v1,
+                                  std::string n2, const AttributeValue &v2)
+{
+  QueueBase::AppendItemTypeIfNotPresent (type, "Packet");
+
+  m_queueFactory.SetTypeId (type);
+  m_queueFactory.Set (n1, v1);
+  m_queueFactory.Set (n2, v2);
+}
+
+void
+SwitchedEthernetHelper::SetDeviceAttribute (std::string n1, const AttributeValue &v1)
+{
+  m_deviceFactory.Set (n1, v1);
+}
+
+void
+SwitchedEthernetHelper::SetChannelAttribute (std::string n1, const AttributeValue &v1)
+{
+  m_channelFactory.Set (n1, v1);
+}
+
+NetDeviceContainer
+SwitchedEthernetHelper::Install (const NodeContainer &c) const
+{
+  Ptr<SwitchedEthernetChannel> channel = m_channelFactory.Create<SwitchedEthernetChannel> ();
+
+  NetDeviceContainer devices;
+  for (NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+    {
+      devices.Add (InstallPriv (*i, channel));
+    }
+  return devices;
+}
+
+Ptr<NetDevice>
+SwitchedEthernetHelper::InstallPriv (Ptr<Node> node, Ptr<SwitchedEthernetChannel> channel) const
+{
+  Ptr<SwitchedEthernetNetDevice> device = m_deviceFactory.Create<SwitchedEthernetNetDevice> ();
+  device->SetAddress (Mac48Address::Allocate ());
+  node->AddDevice (device);
+  device->SetQueue (m_queueFactory.Create<Queue<Packet> > ());
+  device->Attach (channel, m_queueFactory.Create<Queue<Packet> > ());
+
+  //
+  // With a queue interface, the traffic control layer installs its default
+  // root queue disc on the device, as on a CsmaNetDevice, and the device
+  // can stop and wake it.
+  //
+  Ptr<NetDeviceQueueInterface> ndqi = CreateObject<NetDeviceQueueInterface> ();
+  device->AggregateObject (ndqi);
+  return device;
+}
+
+void
+SwitchedEthernetHelper::EnablePcapInternal (std::string prefix, Ptr<NetDevice> nd, bool promiscuous, bool explicitFilename)
+{
+  Ptr<SwitchedEthernetNetDevice> device = nd->GetObject<SwitchedEthernetNetDevice> ();
+  if (device == 0)
+    {
+      NS_LOG_INFO ("SwitchedEthernetHelper::EnablePcapInternal(): Device " << device << " not of type ns3::SwitchedEthernetNetDevice");
+      return;
+    }
+
+  PcapHelper pcapHelper;
+
+  std::string filename;
+  if (explicitFilename)
+    {
+      filename = prefix;
+    }
+  else
+    {
+      filename = pcapHelper.GetFilenameFromDevice (prefix, device);
+    }
+
+  Ptr<PcapFileWrapper> file = pcapHelper.CreateFile (filename, std::ios::out,
+                                                     PcapHelper::DLT_EN10MB);
+  if (promiscuous)
+    {
+      pcapHelper.HookDefaultSink<SwitchedEthernetNetDevice> (device, "PromiscSniffer", file);
+    }
+  else
+    {
+      pcapHelper.HookDefaultSink<SwitchedEthernetNetDevice> (device, "Sniffer", file);
+    }
+}
+
+} // namespace ns3
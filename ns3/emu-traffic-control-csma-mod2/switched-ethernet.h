@@ -0,0 +1,265 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SWITCHED_ETHERNET_H
+#define SWITCHED_ETHERNET_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ns3/channel.h"
+#include "ns3/net-device.h"
+#include "ns3/node.h"
+#include "ns3/node-container.h"
+#include "ns3/net-device-container.h"
+#include "ns3/mac48-address.h"
+#include "ns3/data-rate.h"
+#include "ns3/nstime.h"
+#include "ns3/queue.h"
+#include "ns3/net-device-queue-interface.h"
+#include "ns3/packet.h"
+#include "ns3/object-factory.h"
+#include "ns3/traced-callback.h"
+#include "ns3/trace-helper.h"
+
+namespace ns3 {
+
+class SwitchedEthernetChannel;
+
+//
+// A switched Ethernet segment.
+//
+// Every device installed on the segment owns a full-duplex link to a
+// store-and-forward switch.  Each direction of each link serializes at the
+// channel DataRate on its own, so left->middle and middle->right traffic no
+// longer contend for one shared medium the way they do on a CsmaChannel.
+//
+//   node --[port 0 tx]--> +--------+ --[port 1 egress]--> node
+//   node <-[port 0 egress]-| switch | <-[port 1 tx]------- node
+//                          +--------+
+//
+// The switch learns source MAC addresses per port, forwards known unicast
+// to a single egress queue and floods broadcast, multicast and unknown
+// unicast to every other port.
+//
+
+/**
+ * A NetDevice attached to one port of a SwitchedEthernetChannel.
+ *
+ * Frames are DIX encapsulated.  The device keeps its own transmit queue for
+ * the node->switch direction; the switch->node direction is queued by the
+ * channel.  Like a CsmaNetDevice, it stops the queue disc above it while
+ * the transmit queue is full and reports queued and sent bytes for BQL,
+ * through the NetDeviceQueueInterface the helper aggregates to it.
+ */
+class SwitchedEthernetNetDevice : public NetDevice
+{
+public:
+  static TypeId GetTypeId (void);
+
+  SwitchedEthernetNetDevice ();
+  virtual ~SwitchedEthernetNetDevice ();
+
+  /**
+   * Attach the device to a switched segment.
+   *
+   * \param channel the segment to attach to
+   * \param egressQueue queue used by the switch for frames towards this device
+   */
+  void Attach (Ptr<SwitchedEthernetChannel> channel, Ptr<Queue<Packet> > egressQueue);
+
+  void SetQueue (Ptr<Queue<Packet> > queue);
+  Ptr<Queue<Packet> > GetQueue (void) const;
+
+  /**
+   * Called by the channel once a frame has left the switch egress port and
+   * crossed the link towards this device.
+   */
+  void Receive (Ptr<Packet> packet);
+
+  // inherited from NetDevice
+  virtual void SetIfIndex (const uint32_t index);
+  virtual uint32_t GetIfIndex (void) const;
+  virtual Ptr<Channel> GetChannel (void) const;
+  virtual void SetAddress (Address address);
+  virtual Address GetAddress (void) const;
+  virtual bool SetMtu (const uint16_t mtu);
+  virtual uint16_t GetMtu (void) const;
+  virtual bool IsLinkUp (void) const;
+  virtual void AddLinkChangeCallback (Callback<void> callback);
+  virtual bool IsBroadcast (void) const;
+  virtual Address GetBroadcast (void) const;
+  virtual bool IsMulticast (void) const;
+  virtual Address GetMulticast (Ipv4Address multicastGroup) const;
+  virtual Address GetMulticast (Ipv6Address addr) const;
+  virtual bool IsBridge (void) const;
+  virtual bool IsPointToPoint (void) const;
+  virtual bool Send (Ptr<Packet> packet, const Address& dest, uint16_t protocolNumber);
+  virtual bool SendFrom (Ptr<Packet> packet, const Address& source, const Address& dest, uint16_t protocolNumber);
+  virtual Ptr<Node> GetNode (void) const;
+  virtual void SetNode (Ptr<Node> node);
+  virtual bool NeedsArp (void) const;
+  virtual void SetReceiveCallback (NetDevice::ReceiveCallback cb);
+  virtual void SetPromiscReceiveCallback (NetDevice::PromiscReceiveCallback cb);
+  virtual bool SupportsSendFrom (void) const;
+
+protected:
+  virtual void DoDispose (void);
+  virtual void NotifyNewAggregate (void);
+
+private:
+  void TransmitStart (void);
+  void TransmitComplete (void);
+
+  /** Whether the transmit queue could not take another full frame. */
+  bool IsQueueFull (void) const;
+
+  Ptr<Node> m_node;
+  Ptr<SwitchedEthernetChannel> m_channel;
+  Ptr<Queue<Packet> > m_queue;
+  Ptr<NetDeviceQueueInterface> m_queueInterface;
+  Mac48Address m_address;
+  uint32_t m_ifIndex;
+  uint32_t m_port;
+  uint16_t m_mtu;
+  bool m_linkUp;
+  bool m_txBusy;
+
+  NetDevice::ReceiveCallback m_rxCallback;
+  NetDevice::PromiscReceiveCallback m_promiscRxCallback;
+
+  TracedCallback<> m_linkChangeCallbacks;
+  TracedCallback<Ptr<const Packet> > m_macTxTrace;
+  TracedCallback<Ptr<const Packet> > m_macTxDropTrace;
+  TracedCallback<Ptr<const Packet> > m_macRxTrace;
+  TracedCallback<Ptr<const Packet> > m_snifferTrace;
+  TracedCallback<Ptr<const Packet> > m_promiscSnifferTrace;
+};
+
+/**
+ * The switch fabric and the full-duplex links of a switched segment.
+ *
+ * DataRate applies independently to every direction of every port.  Delay is
+ * the propagation delay between any two ports and is charged once, on the
+ * way into the switch, so a frame from one device to another sees the same
+ * Delay it would on a CsmaChannel.
+ *
+ * Frames carrying a CoalescedSegmentsTag are timed as the train of
+ * original frames they stand for; see segment-offload.h.  Frames carrying
+ * an IngestWaitTag entered the port link when they arrived at the emu
+ * device, not when the simulator picked them up; see ingest-wait-tag.h.
+ */
+class SwitchedEthernetChannel : public Channel
+{
+public:
+  static TypeId GetTypeId (void);
+
+  SwitchedEthernetChannel ();
+  virtual ~SwitchedEthernetChannel ();
+
+  /**
+   * Add a port for the given device.
+   *
+   * \returns the port index assigned to the device
+   */
+  uint32_t Attach (Ptr<SwitchedEthernetNetDevice> device, Ptr<Queue<Packet> > egressQueue);
+
+  /**
+   * Start sending a frame from a device into its switch port.
+   *
+   * \returns how long from now the port link stays busy with the frame
+   */
+  Time TransmitStart (Ptr<const Packet> packet, uint32_t port);
+
+  // inherited from Channel
+  virtual std::size_t GetNDevices (void) const;
+  virtual Ptr<NetDevice> GetDevice (std::size_t i) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  struct Port
+  {
+    Ptr<SwitchedEthernetNetDevice> device;
+    Ptr<Queue<Packet> > egress;
+    bool busy;
+    Time txFreeAt;              // end of the last frame on the node->switch link
+  };
+
+  struct LearnedState
+  {
+    uint32_t port;
+    Time expirationTime;
+  };
+
+  Time CalculateTxTime (Ptr<const Packet> packet, Time &firstTxTime) const;
+  void Forward (Ptr<Packet> packet, uint32_t ingress);
+  void Learn (Mac48Address source, uint32_t port);
+  bool Lookup (Mac48Address destination, uint32_t &port);
+  void Enqueue (uint32_t port, Ptr<Packet> packet);
+  void EgressStart (uint32_t port);
+  void EgressComplete (uint32_t port);
+
+  std::vector<Port> m_ports;
+  std::map<Mac48Address, LearnedState> m_learnedAddresses;
+  DataRate m_bps;
+  Time m_delay;
+  Time m_expirationTime;
+
+  TracedCallback<Ptr<const Packet> > m_dropTrace;
+};
+
+/**
+ * Build a switched segment over a set of nodes, the same way CsmaHelper
+ * builds a shared one.
+ */
+class SwitchedEthernetHelper : public PcapHelperForDevice
+{
+public:
+  SwitchedEthernetHelper ();
+  virtual ~SwitchedEthernetHelper () {}
+
+  /**
+   * Set the type and attributes of the queues used on every port, for both
+   * the device transmit queue and the switch egress queue.
+   */
+  void SetQueue (std::string type,
+                 std::string n1 = "", const AttributeValue &v1 = EmptyAttributeValue (),
+                 std::string n2 = "", const AttributeValue &v2 = EmptyAttributeValue ());
+
+  void SetDeviceAttribute (std::string n1, const AttributeValue &v1);
+  void SetChannelAttribute (std::string n1, const AttributeValue &v1);
+
+  /**
+   * Create one segment and give every node in the container a port on it.
+   */
+  NetDeviceContainer Install (const NodeContainer &c) const;
+
+private:
+  Ptr<NetDevice> InstallPriv (Ptr<Node> node, Ptr<SwitchedEthernetChannel> channel) const;
+
+  virtual void EnablePcapInternal (std::string prefix, Ptr<NetDevice> nd, bool promiscuous, bool explicitFilename);
+
+  ObjectFactory m_queueFactory;
+  ObjectFactory m_deviceFactory;
+  ObjectFactory m_channelFactory;
+};
+
+} // namespace ns3
+
+#endif /* SWITCHED_ETHERNET_H */